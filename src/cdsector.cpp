@@ -0,0 +1,374 @@
+//
+// PSXImager - Mode 2 sector encoding
+//
+// Copyright (C) Christian Bauer <www.cebix.net>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+//
+
+#include "cdsector.h"
+#include "edc.h"
+
+#include <cdio/cdio.h>
+
+extern "C" {
+#include <libvcd/sector.h>
+}
+
+#include <cstdint>
+#include <cstring>
+
+// The vector kernels use GCC target attributes and are only built for x86.
+// AVX2 is left out on Windows where GCC cannot align the stack for 32-byte
+// spills.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#define HAVE_SSE_KERNEL 1
+	#include <immintrin.h>
+	#ifndef _WIN32
+		#define HAVE_AVX2_KERNEL 1
+	#endif
+	#ifdef __i386__
+		#define KERNEL_ENTRY __attribute__((force_align_arg_pointer))
+	#else
+		#define KERNEL_ENTRY
+	#endif
+#endif
+
+
+// Layout of the parity-protected part of a Mode 2 Form 1 sector, relative
+// to the header at byte 12: header, subheader, data and EDC (2064 bytes)
+// followed by the P parity (172 bytes) and the Q parity (104 bytes).
+static const size_t P_OFFSET = 2064;
+static const size_t Q_OFFSET = P_OFFSET + 2 * 86;
+static const size_t Q_SIZE = Q_OFFSET;          // bytes covered by the Q parity
+static const size_t P_COLUMNS = 86, P_ROWS = 24;
+static const size_t Q_DIAGONALS = 52, Q_ROWS = 43;
+
+
+// Lookup tables for the Reed-Solomon product code over GF(2^8) with the
+// polynomial x^8+x^4+x^3+x^2+1
+struct EccTables {
+	uint8_t f[256];       // multiplication by alpha
+	uint8_t b[256];       // division by (alpha + 1)
+	uint8_t bLo[16];      // division by (alpha + 1) of the low nibble
+	uint8_t bHi[16];      // division by (alpha + 1) of the high nibble
+	uint16_t qOffset[Q_ROWS][Q_DIAGONALS / 2];  // byte offsets of the Q diagonal pairs
+
+	constexpr EccTables() : f(), b(), bLo(), bHi(), qOffset()
+	{
+		for (unsigned i = 0; i < 256; ++i) {
+			unsigned j = (i << 1) ^ ((i & 0x80) ? 0x11d : 0);
+			f[i] = uint8_t(j);
+			b[i ^ j] = uint8_t(i);
+		}
+
+		for (unsigned n = 0; n < 16; ++n) {
+			bLo[n] = b[n];
+			bHi[n] = b[n << 4];
+		}
+
+		for (unsigned row = 0; row < Q_ROWS; ++row) {
+			for (unsigned pair = 0; pair < Q_DIAGONALS / 2; ++pair) {
+				qOffset[row][pair] = uint16_t((pair * P_COLUMNS + row * (P_COLUMNS + 2)) % Q_SIZE);
+			}
+		}
+	}
+};
+
+static constexpr EccTables tables;
+
+
+// Calculate the P or Q parity of a block. Each of the 'majorCount' code
+// words consists of 'minorCount' bytes which are 'minorInc' bytes apart.
+static void computeParity(uint8_t * block, size_t majorCount, size_t minorCount, size_t majorMult, size_t minorInc, uint8_t * dest)
+{
+	size_t size = majorCount * minorCount;
+
+	for (size_t major = 0; major < majorCount; ++major) {
+		size_t index = (major >> 1) * majorMult + (major & 1);
+		uint8_t a = 0, b = 0;
+
+		for (size_t minor = 0; minor < minorCount; ++minor) {
+			uint8_t t = block[index];
+			index += minorInc;
+			if (index >= size) {
+				index -= size;
+			}
+			a = tables.f[a ^ t];
+			b ^= t;
+		}
+
+		a = tables.b[tables.f[a] ^ b];
+		dest[major] = a;
+		dest[major + majorCount] = a ^ b;
+	}
+}
+
+
+// Scalar P/Q parity kernel. 'block' points to the sector header, which must
+// be zero.
+static void eccScalar(uint8_t * block)
+{
+	computeParity(block, P_COLUMNS, P_ROWS, 2, P_COLUMNS, block + P_OFFSET);
+	computeParity(block, Q_DIAGONALS, Q_ROWS, P_COLUMNS, P_COLUMNS + 2, block + Q_OFFSET);
+}
+
+
+#ifdef HAVE_SSE_KERNEL
+
+// Collect the Q code words into rows of 64 bytes, so that byte i of each row
+// belongs to code word i.
+static void gatherQ(const uint8_t * block, uint8_t (* rows)[64])
+{
+	for (size_t row = 0; row < Q_ROWS; ++row) {
+		for (size_t pair = 0; pair < Q_DIAGONALS / 2; ++pair) {
+			memcpy(rows[row] + pair * 2, block + tables.qOffset[row][pair], 2);
+		}
+		memset(rows[row] + Q_DIAGONALS, 0, 64 - Q_DIAGONALS);
+	}
+}
+
+
+// SSE kernel, working on 16 code words at a time. The multiplication by
+// alpha is done with a shift and a conditional XOR, the final division by
+// (alpha + 1) with PSHUFB nibble table lookups.
+__attribute__((target("sse4.1"))) static inline __m128i mulAlphaSSE(__m128i a)
+{
+	__m128i carry = _mm_cmplt_epi8(a, _mm_setzero_si128());
+	return _mm_xor_si128(_mm_add_epi8(a, a), _mm_and_si128(carry, _mm_set1_epi8(0x1d)));
+}
+
+__attribute__((target("sse4.1"))) static inline __m128i divAlpha1SSE(__m128i x)
+{
+	const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(tables.bLo));
+	const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(tables.bHi));
+	const __m128i mask = _mm_set1_epi8(0x0f);
+
+	return _mm_xor_si128(_mm_shuffle_epi8(lo, _mm_and_si128(x, mask)),
+	                     _mm_shuffle_epi8(hi, _mm_and_si128(_mm_srli_epi16(x, 4), mask)));
+}
+
+// Run the parity recurrence over 'rows' rows of 'n' vectors, 'stride' bytes
+// apart, and store the two parity vectors for 'count' code words.
+template <size_t n>
+__attribute__((target("sse4.1"))) static inline void paritySSE(const uint8_t * src, size_t rows, size_t stride, size_t count, uint8_t * dest)
+{
+	__m128i a[n], b[n];
+	for (size_t v = 0; v < n; ++v) {
+		a[v] = b[v] = _mm_setzero_si128();
+	}
+
+	for (size_t row = 0; row < rows; ++row) {
+		for (size_t v = 0; v < n; ++v) {
+			__m128i t = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + row * stride + v * 16));
+			a[v] = mulAlphaSSE(_mm_xor_si128(a[v], t));
+			b[v] = _mm_xor_si128(b[v], t);
+		}
+	}
+
+	uint8_t out0[n * 16], out1[n * 16];
+	for (size_t v = 0; v < n; ++v) {
+		__m128i p = divAlpha1SSE(_mm_xor_si128(mulAlphaSSE(a[v]), b[v]));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out0 + v * 16), p);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out1 + v * 16), _mm_xor_si128(p, b[v]));
+	}
+
+	memcpy(dest, out0, count);
+	memcpy(dest + count, out1, count);
+}
+
+KERNEL_ENTRY __attribute__((target("sse4.1"))) static void eccSSE(uint8_t * block)
+{
+	// P code words are the columns of 24 rows of 86 bytes. Reading 96 bytes
+	// per row stays within the sector, the extra lanes are discarded.
+	paritySSE<6>(block, P_ROWS, P_COLUMNS, P_COLUMNS, block + P_OFFSET);
+
+	uint8_t rows[Q_ROWS][64];
+	gatherQ(block, rows);
+	paritySSE<4>(rows[0], Q_ROWS, 64, Q_DIAGONALS, block + Q_OFFSET);
+}
+
+#endif  // HAVE_SSE_KERNEL
+
+
+#ifdef HAVE_AVX2_KERNEL
+
+// AVX2 kernel, working on 32 code words at a time
+__attribute__((target("avx2"))) static inline __m256i mulAlphaAVX2(__m256i a)
+{
+	__m256i carry = _mm256_cmpgt_epi8(_mm256_setzero_si256(), a);
+	return _mm256_xor_si256(_mm256_add_epi8(a, a), _mm256_and_si256(carry, _mm256_set1_epi8(0x1d)));
+}
+
+__attribute__((target("avx2"))) static inline __m256i divAlpha1AVX2(__m256i x)
+{
+	const __m256i lo = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(tables.bLo)));
+	const __m256i hi = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(tables.bHi)));
+	const __m256i mask = _mm256_set1_epi8(0x0f);
+
+	return _mm256_xor_si256(_mm256_shuffle_epi8(lo, _mm256_and_si256(x, mask)),
+	                        _mm256_shuffle_epi8(hi, _mm256_and_si256(_mm256_srli_epi16(x, 4), mask)));
+}
+
+template <size_t n>
+__attribute__((target("avx2"))) static inline void parityAVX2(const uint8_t * src, size_t rows, size_t stride, size_t count, uint8_t * dest)
+{
+	__m256i a[n], b[n];
+	for (size_t v = 0; v < n; ++v) {
+		a[v] = b[v] = _mm256_setzero_si256();
+	}
+
+	for (size_t row = 0; row < rows; ++row) {
+		for (size_t v = 0; v < n; ++v) {
+			__m256i t = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + row * stride + v * 32));
+			a[v] = mulAlphaAVX2(_mm256_xor_si256(a[v], t));
+			b[v] = _mm256_xor_si256(b[v], t);
+		}
+	}
+
+	uint8_t out0[n * 32], out1[n * 32];
+	for (size_t v = 0; v < n; ++v) {
+		__m256i p = divAlpha1AVX2(_mm256_xor_si256(mulAlphaAVX2(a[v]), b[v]));
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(out0 + v * 32), p);
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(out1 + v * 32), _mm256_xor_si256(p, b[v]));
+	}
+
+	memcpy(dest, out0, count);
+	memcpy(dest + count, out1, count);
+}
+
+__attribute__((target("avx2"))) static void eccAVX2(uint8_t * block)
+{
+	parityAVX2<3>(block, P_ROWS, P_COLUMNS, P_COLUMNS, block + P_OFFSET);
+
+	uint8_t rows[Q_ROWS][64];
+	gatherQ(block, rows);
+	parityAVX2<2>(rows[0], Q_ROWS, 64, Q_DIAGONALS, block + Q_OFFSET);
+}
+
+#endif  // HAVE_AVX2_KERNEL
+
+
+// Select the fastest P/Q parity kernel supported by the CPU.
+struct EccKernel {
+	void (* run)(uint8_t *);
+	const char * name;
+};
+
+static EccKernel selectEccKernel()
+{
+#ifdef HAVE_SSE_KERNEL
+	__builtin_cpu_init();
+#ifdef HAVE_AVX2_KERNEL
+	if (__builtin_cpu_supports("avx2")) {
+		return { eccAVX2, "AVX2" };
+	}
+#endif
+	if (__builtin_cpu_supports("sse4.1")) {
+		return { eccSSE, "SSE4" };
+	}
+#endif
+	return { eccScalar, "scalar" };
+}
+
+static const EccKernel eccKernel = selectEccKernel();
+
+
+// Build a raw Mode 2 sector.
+void encodeMode2Sector(void * raw, const void * data, uint32_t lsn, uint8_t fnum, uint8_t cnum, uint8_t sm, uint8_t ci)
+{
+	uint8_t * p = static_cast<uint8_t *>(raw);
+	memset(p, 0, CDIO_CD_FRAMESIZE_RAW);
+
+	// Subheader (the header is filled in last because it must be zero
+	// while calculating the ECC)
+	p[16] = p[20] = fnum;
+	p[17] = p[21] = cnum;
+	p[18] = p[22] = sm;
+	p[19] = p[23] = ci;
+
+	if (sm & SM_FORM2) {
+		memcpy(p + CDIO_CD_XA_SYNC_HEADER, data, M2F2_SECTOR_SIZE);
+
+		uint32_t edc = computeEDC(p + CDIO_CD_SYNC_SIZE + CDIO_CD_HEADER_SIZE, CDIO_CD_SUBHEADER_SIZE + M2F2_SECTOR_SIZE);
+		for (unsigned i = 0; i < 4; ++i) {
+			p[CDIO_CD_XA_SYNC_HEADER + M2F2_SECTOR_SIZE + i] = uint8_t(edc >> (i * 8));
+		}
+	} else {
+		memcpy(p + CDIO_CD_XA_SYNC_HEADER, data, CDIO_CD_FRAMESIZE);
+
+		uint32_t edc = computeEDC(p + CDIO_CD_SYNC_SIZE + CDIO_CD_HEADER_SIZE, CDIO_CD_SUBHEADER_SIZE + CDIO_CD_FRAMESIZE);
+		for (unsigned i = 0; i < 4; ++i) {
+			p[CDIO_CD_XA_SYNC_HEADER + CDIO_CD_FRAMESIZE + i] = uint8_t(edc >> (i * 8));
+		}
+
+		eccKernel.run(p + CDIO_CD_SYNC_SIZE);
+	}
+
+	// Sync pattern
+	memset(p + 1, 0xff, 10);
+
+	setMode2SectorAddress(p, lsn);
+}
+
+
+// Fill in the header of a raw Mode 2 sector.
+void setMode2SectorAddress(void * raw, uint32_t lsn)
+{
+	uint8_t * p = static_cast<uint8_t *>(raw);
+
+	// Header with BCD-encoded MSF address
+	uint32_t address = lsn + CDIO_PREGAP_SECTORS;
+	auto bcd = [](uint32_t v) -> uint8_t { return uint8_t(((v / 10) << 4) | (v % 10)); };
+
+	p[12] = bcd(address / (75 * 60));
+	p[13] = bcd((address / 75) % 60);
+	p[14] = bcd(address % 75);
+	p[15] = 2;  // mode
+}
+
+
+// Check the EDC of a raw sector.
+EDCStatus checkSectorEDC(const void * raw)
+{
+	const uint8_t * p = static_cast<const uint8_t *>(raw);
+
+	size_t begin, end;
+	switch (p[15]) {
+		case 1:
+			begin = 0;
+			end = CDIO_CD_SYNC_SIZE + CDIO_CD_HEADER_SIZE + CDIO_CD_FRAMESIZE;
+			break;
+		case 2:
+			begin = CDIO_CD_SYNC_SIZE + CDIO_CD_HEADER_SIZE;
+			end = CDIO_CD_XA_SYNC_HEADER + ((p[18] & SM_FORM2) ? M2F2_SECTOR_SIZE : CDIO_CD_FRAMESIZE);
+			break;
+		default:
+			return EDC_NONE;
+	}
+
+	uint32_t stored = uint32_t(p[end]) | (uint32_t(p[end + 1]) << 8) | (uint32_t(p[end + 2]) << 16) | (uint32_t(p[end + 3]) << 24);
+	if (stored == 0 && p[15] == 2 && (p[18] & SM_FORM2)) {
+		return EDC_ZERO;
+	}
+	return computeEDC(p + begin, end - begin) == stored ? EDC_OK : EDC_ERROR;
+}
+
+
+// Return the name of the selected P/Q parity kernel.
+const char * eccKernelName()
+{
+	return eccKernel.name;
+}
@@ -0,0 +1,53 @@
+//
+// PSXImager - Mode 2 sector encoding
+//
+// Copyright (C) Christian Bauer <www.cebix.net>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+//
+
+#ifndef PSXIMAGER_CDSECTOR_H
+#define PSXIMAGER_CDSECTOR_H
+
+#include <cstdint>
+
+
+// Build a raw (2352 byte) Mode 2 sector with sync pattern, header, subheader,
+// EDC and (for Form 1) ECC from the given payload, which is 2324 bytes for
+// Form 2 sectors (SM_FORM2 set in 'sm') and 2048 bytes otherwise. 'lsn' is
+// the logical sector number. The result is identical to that of libvcd's
+// _vcd_make_mode2().
+void encodeMode2Sector(void * raw, const void * data, uint32_t lsn, uint8_t fnum, uint8_t cnum, uint8_t sm, uint8_t ci);
+
+// Set the header of a raw Mode 2 sector to the address of the logical
+// sector number 'lsn'. The EDC and ECC of a Mode 2 sector don't cover the
+// header, so this moves an encoded sector to another position.
+void setMode2SectorAddress(void * raw, uint32_t lsn);
+
+// Return the name of the P/Q parity kernel selected for this CPU.
+const char * eccKernelName();
+
+// Result of checkSectorEDC()
+enum EDCStatus {
+	EDC_OK,     // stored EDC matches the sector contents
+	EDC_ZERO,   // Mode 2 Form 2 sector with zeroed-out EDC
+	EDC_ERROR,  // stored EDC does not match
+	EDC_NONE,   // sector has no EDC (mode 0 or unknown mode)
+};
+
+// Check the EDC of a raw (2352 byte) Mode 1 or Mode 2 sector.
+EDCStatus checkSectorEDC(const void * raw);
+
+#endif
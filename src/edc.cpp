@@ -0,0 +1,196 @@
+//
+// PSXImager - CD-ROM error detection code (EDC)
+//
+// Copyright (C) Christian Bauer <www.cebix.net>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+//
+
+#include "edc.h"
+
+#include <cstdint>
+#include <cstring>
+
+// The carry-less multiplication kernel uses GCC target attributes and is
+// only built for x86.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#define HAVE_PCLMUL_KERNEL 1
+	#include <immintrin.h>
+	#ifdef __i386__
+		#define KERNEL_ENTRY __attribute__((force_align_arg_pointer))
+	#else
+		#define KERNEL_ENTRY
+	#endif
+#endif
+
+
+// The EDC is a bit-reflected CRC with the polynomial
+// x^32+x^31+x^16+x^15+x^4+x^3+x+1, no initial value and no final XOR.
+static const uint32_t EDC_POLY = 0xd8018001;
+
+
+// Lookup tables for calculating the EDC 16 bytes at a time. Table 0 is the
+// classic bytewise table, table n advances a byte by n further bytes.
+struct EdcTables {
+	uint32_t t[16][256];
+
+	constexpr EdcTables() : t()
+	{
+		for (unsigned i = 0; i < 256; ++i) {
+			uint32_t e = i;
+			for (unsigned k = 0; k < 8; ++k) {
+				e = (e >> 1) ^ ((e & 1) ? EDC_POLY : 0);
+			}
+			t[0][i] = e;
+		}
+
+		for (unsigned n = 1; n < 16; ++n) {
+			for (unsigned i = 0; i < 256; ++i) {
+				t[n][i] = (t[n - 1][i] >> 8) ^ t[0][t[n - 1][i] & 0xff];
+			}
+		}
+	}
+};
+
+static constexpr EdcTables tables;
+
+
+// Read a little-endian 32-bit value.
+static inline uint32_t load32(const uint8_t * p)
+{
+	return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+
+// Slicing-by-16 kernel
+static uint32_t edcSlice16(const uint8_t * p, size_t size, uint32_t edc)
+{
+	const auto & t = tables.t;
+
+	while (size >= 16) {
+		uint32_t a = load32(p) ^ edc;
+		uint32_t b = load32(p + 4);
+		uint32_t c = load32(p + 8);
+		uint32_t d = load32(p + 12);
+
+		edc = t[15][a & 0xff] ^ t[14][(a >> 8) & 0xff] ^ t[13][(a >> 16) & 0xff] ^ t[12][a >> 24]
+		    ^ t[11][b & 0xff] ^ t[10][(b >> 8) & 0xff] ^ t[ 9][(b >> 16) & 0xff] ^ t[ 8][b >> 24]
+		    ^ t[ 7][c & 0xff] ^ t[ 6][(c >> 8) & 0xff] ^ t[ 5][(c >> 16) & 0xff] ^ t[ 4][c >> 24]
+		    ^ t[ 3][d & 0xff] ^ t[ 2][(d >> 8) & 0xff] ^ t[ 1][(d >> 16) & 0xff] ^ t[ 0][d >> 24];
+
+		p += 16;
+		size -= 16;
+	}
+
+	while (size--) {
+		edc = (edc >> 8) ^ t[0][(edc ^ *p++) & 0xff];
+	}
+
+	return edc;
+}
+
+
+#ifdef HAVE_PCLMUL_KERNEL
+
+// Folding constants x^n mod P (bit-reflected, shifted left by one) for
+// advancing a 128-bit lane by 512 bits (x^544, x^480) and by 128 bits
+// (x^160, x^96).
+static const uint64_t K1 = 0x1f8931102, K2 = 0x12e7928a2;
+static const uint64_t K3 = 0x06c90c100, K4 = 0x1d5934102;
+
+__attribute__((target("pclmul,sse4.1"))) static inline __m128i fold(__m128i x, __m128i k)
+{
+	return _mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00), _mm_clmulepi64_si128(x, k, 0x11));
+}
+
+// Carry-less multiplication kernel. Four 128-bit lanes are folded forward
+// over the data 64 bytes at a time, then combined into one. The remaining
+// 128 bits are reduced with the table, which avoids a Barrett reduction.
+KERNEL_ENTRY __attribute__((target("pclmul,sse4.1"))) static uint32_t edcPCLMUL(const uint8_t * p, size_t size, uint32_t edc)
+{
+	if (size < 64) {
+		return edcSlice16(p, size, edc);
+	}
+
+	const __m128i k12 = _mm_set_epi64x(K2, K1);
+	const __m128i k34 = _mm_set_epi64x(K4, K3);
+	auto load = [](const uint8_t * q) { return _mm_loadu_si128(reinterpret_cast<const __m128i *>(q)); };
+
+	__m128i x0 = _mm_xor_si128(load(p), _mm_cvtsi32_si128(int(edc)));
+	__m128i x1 = load(p + 16);
+	__m128i x2 = load(p + 32);
+	__m128i x3 = load(p + 48);
+	p += 64;
+	size -= 64;
+
+	while (size >= 64) {
+		x0 = _mm_xor_si128(fold(x0, k12), load(p));
+		x1 = _mm_xor_si128(fold(x1, k12), load(p + 16));
+		x2 = _mm_xor_si128(fold(x2, k12), load(p + 32));
+		x3 = _mm_xor_si128(fold(x3, k12), load(p + 48));
+		p += 64;
+		size -= 64;
+	}
+
+	__m128i x = _mm_xor_si128(fold(x0, k34), x1);
+	x = _mm_xor_si128(fold(x, k34), x2);
+	x = _mm_xor_si128(fold(x, k34), x3);
+
+	while (size >= 16) {
+		x = _mm_xor_si128(fold(x, k34), load(p));
+		p += 16;
+		size -= 16;
+	}
+
+	uint8_t rest[16];
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(rest), x);
+	return edcSlice16(p, size, edcSlice16(rest, 16, 0));
+}
+
+#endif  // HAVE_PCLMUL_KERNEL
+
+
+// Select the fastest EDC kernel supported by the CPU.
+struct EdcKernel {
+	uint32_t (* run)(const uint8_t *, size_t, uint32_t);
+	const char * name;
+};
+
+static EdcKernel selectEdcKernel()
+{
+#ifdef HAVE_PCLMUL_KERNEL
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1")) {
+		return { edcPCLMUL, "PCLMUL" };
+	}
+#endif
+	return { edcSlice16, "slice-by-16" };
+}
+
+static const EdcKernel edcKernel = selectEdcKernel();
+
+
+// Calculate the EDC of a block of data.
+uint32_t computeEDC(const void * data, size_t size, uint32_t edc)
+{
+	return edcKernel.run(static_cast<const uint8_t *>(data), size, edc);
+}
+
+
+// Return the name of the selected EDC kernel.
+const char * edcKernelName()
+{
+	return edcKernel.name;
+}
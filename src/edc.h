@@ -0,0 +1,37 @@
+//
+// PSXImager - CD-ROM error detection code (EDC)
+//
+// Copyright (C) Christian Bauer <www.cebix.net>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+//
+
+#ifndef PSXIMAGER_EDC_H
+#define PSXIMAGER_EDC_H
+
+#include <cstddef>
+#include <cstdint>
+
+
+// Calculate the EDC (the CRC with the polynomial
+// x^32+x^31+x^16+x^15+x^4+x^3+x+1 used by CD-ROM sectors) of a block of
+// data. An EDC over several blocks is obtained by passing the result for
+// the previous block as 'edc'.
+uint32_t computeEDC(const void * data, size_t size, uint32_t edc = 0);
+
+// Return the name of the EDC kernel selected for this CPU.
+const char * edcKernelName();
+
+#endif
@@ -0,0 +1,195 @@
+//
+// PSXImager - Copying byte ranges between files
+//
+// Copyright (C) Christian Bauer <www.cebix.net>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+//
+
+#include "filecopy.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+namespace fs = std::filesystem;
+using namespace std;
+
+// Linux can copy between files inside the kernel. copy_file_range() is
+// available from glibc 2.27 on, sendfile() also handles file-to-file
+// copies since Linux 2.6.33. posix_fadvise() is used for read-ahead hints.
+#if defined(__linux__)
+	#define HAVE_SENDFILE 1
+	#define HAVE_POSIX_FADVISE 1
+	#include <fcntl.h>
+	#include <sys/sendfile.h>
+	#include <unistd.h>
+	#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 27))
+		#define HAVE_COPY_FILE_RANGE 1
+	#endif
+#endif
+
+
+#ifdef HAVE_SENDFILE
+
+// File descriptor which is closed when going out of scope.
+class FileDescriptor {
+public:
+	explicit FileDescriptor(int fd) : fd(fd) { }
+	~FileDescriptor() { if (fd >= 0) close(fd); }
+
+	FileDescriptor(const FileDescriptor &) = delete;
+	FileDescriptor & operator=(const FileDescriptor &) = delete;
+
+	operator int() const { return fd; }
+
+private:
+	int fd;
+};
+
+
+// Return true if the error code of a failed in-kernel copy means that the
+// files cannot be copied that way, rather than an I/O error.
+static bool isUnsupported(int error)
+{
+	return error == ENOSYS || error == EXDEV || error == EINVAL || error == EOPNOTSUPP;
+}
+
+
+// Copy as much of the range as possible inside the kernel. The offsets and
+// size are advanced past the copied data.
+static void kernelCopy(const fs::path & src, uint64_t & srcOffset, const fs::path & dst, uint64_t & dstOffset, uint64_t & size)
+{
+	FileDescriptor in(open(src.c_str(), O_RDONLY | O_CLOEXEC));
+	if (in < 0) {
+		throw runtime_error(format("Cannot open file {}: {}", src.string(), strerror(errno)));
+	}
+
+	FileDescriptor out(open(dst.c_str(), O_WRONLY | O_CLOEXEC));
+	if (out < 0) {
+		throw runtime_error(format("Cannot open file {}: {}", dst.string(), strerror(errno)));
+	}
+
+	// Transfer at most 1 GiB per call, which all kernels accept
+	const uint64_t maxChunk = uint64_t(1) << 30;
+
+#ifdef HAVE_COPY_FILE_RANGE
+	bool useCopyFileRange = true;
+#endif
+
+	while (size > 0) {
+		size_t chunk = size_t(min(size, maxChunk));
+		ssize_t n = -1;
+
+#ifdef HAVE_COPY_FILE_RANGE
+		if (useCopyFileRange) {
+			loff_t inOffset = loff_t(srcOffset), outOffset = loff_t(dstOffset);
+			n = copy_file_range(in, &inOffset, out, &outOffset, chunk, 0);
+			if (n < 0 && isUnsupported(errno)) {
+				useCopyFileRange = false;  // retry with sendfile()
+				continue;
+			}
+		} else
+#endif
+		{
+			off_t inOffset = off_t(srcOffset);
+			if (lseek(out, off_t(dstOffset), SEEK_SET) < 0) {
+				return;  // fall back to the buffered copy
+			}
+			n = sendfile(out, in, &inOffset, chunk);
+			if (n < 0 && isUnsupported(errno)) {
+				return;
+			}
+		}
+
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			throw runtime_error(format("Error copying {} to {}: {}", src.string(), dst.string(), strerror(errno)));
+		} else if (n == 0) {
+			throw runtime_error(format("Unexpected end of file {}", src.string()));
+		}
+
+		srcOffset += n;
+		dstOffset += n;
+		size -= n;
+	}
+}
+
+#endif  // HAVE_SENDFILE
+
+
+// Copy a range of one file to another.
+void copyFileRange(const fs::path & src, uint64_t srcOffset, const fs::path & dst, uint64_t dstOffset, uint64_t size)
+{
+#ifdef HAVE_SENDFILE
+	kernelCopy(src, srcOffset, dst, dstOffset, size);
+#endif
+	if (size == 0) {
+		return;
+	}
+
+	// Copy the rest through a buffer
+	ifstream in(src, ifstream::in | ifstream::binary);
+	if (!in) {
+		throw runtime_error(format("Cannot open file {}", src.string()));
+	}
+
+	fstream out(dst, fstream::in | fstream::out | fstream::binary);
+	if (!out) {
+		throw runtime_error(format("Cannot open file {}", dst.string()));
+	}
+
+	in.seekg(srcOffset);
+	out.seekp(dstOffset);
+
+	vector<char> buffer(size_t(min<uint64_t>(size, 4 * 1024 * 1024)));
+
+	while (size > 0) {
+		size_t chunk = size_t(min<uint64_t>(size, buffer.size()));
+
+		in.read(buffer.data(), chunk);
+		if (size_t(in.gcount()) != chunk) {
+			throw runtime_error(format("Unexpected end of file {}", src.string()));
+		}
+
+		out.write(buffer.data(), chunk);
+		if (!out) {
+			throw runtime_error(format("Error writing to file {}", dst.string()));
+		}
+
+		size -= chunk;
+	}
+}
+
+
+// Ask the system to read a range of a file into the cache.
+void prefetchFileRange(const fs::path & path, uint64_t offset, uint64_t size)
+{
+#ifdef HAVE_POSIX_FADVISE
+	FileDescriptor fd(open(path.c_str(), O_RDONLY | O_CLOEXEC));
+	if (fd >= 0) {
+		posix_fadvise(fd, off_t(offset), off_t(size), POSIX_FADV_WILLNEED);
+	}
+#else
+	(void)path;
+	(void)offset;
+	(void)size;
+#endif
+}
@@ -0,0 +1,42 @@
+//
+// PSXImager - Copying byte ranges between files
+//
+// Copyright (C) Christian Bauer <www.cebix.net>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+//
+
+#ifndef PSXIMAGER_FILECOPY_H
+#define PSXIMAGER_FILECOPY_H
+
+#include <cstdint>
+#include <filesystem>
+
+
+// Copy 'size' bytes at offset 'srcOffset' of the file 'src' to offset
+// 'dstOffset' of the existing file 'dst', extending it if necessary. Where
+// the system supports it the data is copied inside the kernel (Linux
+// copy_file_range() or sendfile()), otherwise through a large buffer.
+// Throws a runtime_error if 'src' is too short or an I/O error occurs.
+void copyFileRange(const std::filesystem::path & src, uint64_t srcOffset,
+                   const std::filesystem::path & dst, uint64_t dstOffset, uint64_t size);
+
+// Tell the system that 'size' bytes at offset 'offset' of the file 'path'
+// will be read soon, so it can start reading them into the cache in the
+// background (Linux posix_fadvise(POSIX_FADV_WILLNEED)). This is only a
+// hint: errors are ignored, and elsewhere the function does nothing.
+void prefetchFileRange(const std::filesystem::path & path, uint64_t offset, uint64_t size);
+
+#endif
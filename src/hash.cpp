@@ -0,0 +1,334 @@
+//
+// PSXImager - Checksums and message digests of file contents
+//
+// Copyright (C) Christian Bauer <www.cebix.net>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+//
+
+#include "hash.h"
+
+#include <array>
+#include <bit>
+#include <cstring>
+#include <format>
+using namespace std;
+
+
+// Lookup tables for slice-by-8 CRC computation: crcTables[0] is the
+// byte-at-a-time table, crcTables[k] advances a byte by k more zero bytes.
+static constexpr auto crcTables = [] {
+	array<array<uint32_t, 256>, 8> t{};
+	for (uint32_t i = 0; i < 256; ++i) {
+		uint32_t c = i;
+		for (int k = 0; k < 8; ++k) {
+			c = (c >> 1) ^ ((c & 1) ? 0xedb88320 : 0);
+		}
+		t[0][i] = c;
+	}
+	for (uint32_t i = 0; i < 256; ++i) {
+		for (size_t k = 1; k < 8; ++k) {
+			t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xff];
+		}
+	}
+	return t;
+}();
+
+
+// Add data to the CRC.
+void CRC32::update(const void * data, size_t size)
+{
+	auto p = static_cast<const uint8_t *>(data);
+	uint32_t c = crc;
+
+	// Eight bytes at a time
+	while (size >= 8) {
+		uint32_t lo = c ^ (uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24);
+		uint32_t hi = uint32_t(p[4]) | uint32_t(p[5]) << 8 | uint32_t(p[6]) << 16 | uint32_t(p[7]) << 24;
+		c = crcTables[7][lo & 0xff] ^ crcTables[6][(lo >> 8) & 0xff] ^
+		    crcTables[5][(lo >> 16) & 0xff] ^ crcTables[4][lo >> 24] ^
+		    crcTables[3][hi & 0xff] ^ crcTables[2][(hi >> 8) & 0xff] ^
+		    crcTables[1][(hi >> 16) & 0xff] ^ crcTables[0][hi >> 24];
+		p += 8;
+		size -= 8;
+	}
+
+	while (size--) {
+		c = (c >> 8) ^ crcTables[0][(c ^ *p++) & 0xff];
+	}
+
+	crc = c;
+}
+
+
+// Return the CRC as hex string.
+string CRC32::hex() const
+{
+	return format("{:08x}", value());
+}
+
+
+// Start a new SHA-1 computation.
+SHA1::SHA1()
+	: state{ 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0 }
+{
+}
+
+
+// Run the compression function on one 64-byte block.
+void SHA1::processBlock(const uint8_t * block)
+{
+	uint32_t w[80];
+	for (int i = 0; i < 16; ++i) {
+		w[i] = uint32_t(block[i * 4]) << 24 | uint32_t(block[i * 4 + 1]) << 16 |
+		       uint32_t(block[i * 4 + 2]) << 8 | uint32_t(block[i * 4 + 3]);
+	}
+	for (int i = 16; i < 80; ++i) {
+		w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+	}
+
+	uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+
+	for (int i = 0; i < 80; ++i) {
+		uint32_t f, k;
+		if (i < 20) {
+			f = (b & c) | (~b & d);
+			k = 0x5a827999;
+		} else if (i < 40) {
+			f = b ^ c ^ d;
+			k = 0x6ed9eba1;
+		} else if (i < 60) {
+			f = (b & c) | (b & d) | (c & d);
+			k = 0x8f1bbcdc;
+		} else {
+			f = b ^ c ^ d;
+			k = 0xca62c1d6;
+		}
+
+		uint32_t t = rotl(a, 5) + f + e + k + w[i];
+		e = d;
+		d = c;
+		c = rotl(b, 30);
+		b = a;
+		a = t;
+	}
+
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+	state[4] += e;
+}
+
+
+// Add data to the digest.
+void SHA1::update(const void * data, size_t size)
+{
+	auto p = static_cast<const uint8_t *>(data);
+	length += size;
+
+	// Complete a partially filled block first
+	if (bufferUsed > 0) {
+		size_t n = min(size, sizeof(buffer) - bufferUsed);
+		memcpy(buffer + bufferUsed, p, n);
+		bufferUsed += n;
+		p += n;
+		size -= n;
+
+		if (bufferUsed < sizeof(buffer)) {
+			return;
+		}
+		processBlock(buffer);
+		bufferUsed = 0;
+	}
+
+	// Whole blocks are processed in place
+	while (size >= sizeof(buffer)) {
+		processBlock(p);
+		p += sizeof(buffer);
+		size -= sizeof(buffer);
+	}
+
+	memcpy(buffer, p, size);
+	bufferUsed = size;
+}
+
+
+// Append the padding and the message length, and return the digest.
+string SHA1::hex()
+{
+	uint64_t bitLength = length * 8;
+
+	uint8_t padding[72] = { 0x80 };
+	size_t padSize = (bufferUsed < 56 ? 56 : 120) - bufferUsed;
+	for (int i = 0; i < 8; ++i) {
+		padding[padSize + i] = uint8_t(bitLength >> (56 - i * 8));
+	}
+	update(padding, padSize + 8);
+
+	string result;
+	for (uint32_t s : state) {
+		result += format("{:08x}", s);
+	}
+	return result;
+}
+
+
+// Per-round shift amounts and sine-derived constants of MD5
+static constexpr uint8_t md5Shifts[64] = {
+	7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+	5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20,
+	4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+	6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21,
+};
+
+static constexpr uint32_t md5Constants[64] = {
+	0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+	0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+	0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+	0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+	0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+	0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+	0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+	0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391,
+};
+
+
+// Start a new MD5 computation.
+MD5::MD5()
+	: state{ 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 }
+{
+}
+
+
+// Run the compression function on one 64-byte block.
+void MD5::processBlock(const uint8_t * block)
+{
+	uint32_t m[16];
+	for (int i = 0; i < 16; ++i) {
+		m[i] = uint32_t(block[i * 4]) | uint32_t(block[i * 4 + 1]) << 8 |
+		       uint32_t(block[i * 4 + 2]) << 16 | uint32_t(block[i * 4 + 3]) << 24;
+	}
+
+	uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+
+	for (int i = 0; i < 64; ++i) {
+		uint32_t f;
+		int g;
+		if (i < 16) {
+			f = (b & c) | (~b & d);
+			g = i;
+		} else if (i < 32) {
+			f = (d & b) | (~d & c);
+			g = (5 * i + 1) & 15;
+		} else if (i < 48) {
+			f = b ^ c ^ d;
+			g = (3 * i + 5) & 15;
+		} else {
+			f = c ^ (b | ~d);
+			g = (7 * i) & 15;
+		}
+
+		uint32_t t = d;
+		d = c;
+		c = b;
+		b += rotl(a + f + md5Constants[i] + m[g], md5Shifts[i]);
+		a = t;
+	}
+
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+}
+
+
+// Add data to the digest.
+void MD5::update(const void * data, size_t size)
+{
+	auto p = static_cast<const uint8_t *>(data);
+	length += size;
+
+	// Complete a partially filled block first
+	if (bufferUsed > 0) {
+		size_t n = min(size, sizeof(buffer) - bufferUsed);
+		memcpy(buffer + bufferUsed, p, n);
+		bufferUsed += n;
+		p += n;
+		size -= n;
+
+		if (bufferUsed < sizeof(buffer)) {
+			return;
+		}
+		processBlock(buffer);
+		bufferUsed = 0;
+	}
+
+	// Whole blocks are processed in place
+	while (size >= sizeof(buffer)) {
+		processBlock(p);
+		p += sizeof(buffer);
+		size -= sizeof(buffer);
+	}
+
+	memcpy(buffer, p, size);
+	bufferUsed = size;
+}
+
+
+// Append the padding and the message length, and return the digest.
+string MD5::hex()
+{
+	uint64_t bitLength = length * 8;
+
+	uint8_t padding[72] = { 0x80 };
+	size_t padSize = (bufferUsed < 56 ? 56 : 120) - bufferUsed;
+	for (int i = 0; i < 8; ++i) {
+		padding[padSize + i] = uint8_t(bitLength >> (i * 8));
+	}
+	update(padding, padSize + 8);
+
+	string result;
+	for (uint32_t s : state) {
+		for (int i = 0; i < 4; ++i) {
+			result += format("{:02x}", uint8_t(s >> (i * 8)));
+		}
+	}
+	return result;
+}
+
+
+// Add data to all digests.
+void RedumpHash::update(const void * data, size_t size)
+{
+	length += size;
+	crc.update(data, size);
+	md5.update(data, size);
+	sha1.update(data, size);
+}
+
+
+// Return the size and all digests.
+RedumpHash::Values RedumpHash::finish()
+{
+	return { length, crc.hex(), md5.hex(), sha1.hex() };
+}
+
+
+// Format the size and digests for output.
+string RedumpHash::Values::toString() const
+{
+	return format("size {}  crc {}  md5 {}  sha1 {}", size, crc, md5, sha1);
+}
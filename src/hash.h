@@ -0,0 +1,114 @@
+//
+// PSXImager - Checksums and message digests of file contents
+//
+// Copyright (C) Christian Bauer <www.cebix.net>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+//
+
+#ifndef PSXIMAGER_HASH_H
+#define PSXIMAGER_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+// CRC-32 with the polynomial 0x04c11db7 (bit-reflected), as used by zip,
+// PNG and the Redump database, computed incrementally.
+class CRC32 {
+public:
+	void update(const void * data, size_t size);
+
+	uint32_t value() const { return ~crc; }
+
+	// Value as 8 lowercase hex digits
+	std::string hex() const;
+
+private:
+	uint32_t crc = 0xffffffff;
+};
+
+
+// SHA-1 message digest, computed incrementally.
+class SHA1 {
+public:
+	SHA1();
+
+	void update(const void * data, size_t size);
+
+	// Finish the computation and return the digest as 40 lowercase hex
+	// digits. No more data may be added afterwards.
+	std::string hex();
+
+private:
+	void processBlock(const uint8_t * block);
+
+	uint32_t state[5];
+	uint64_t length = 0;  // total number of bytes
+	uint8_t buffer[64];
+	size_t bufferUsed = 0;
+};
+
+
+// MD5 message digest, computed incrementally.
+class MD5 {
+public:
+	MD5();
+
+	void update(const void * data, size_t size);
+
+	// Finish the computation and return the digest as 32 lowercase hex
+	// digits. No more data may be added afterwards.
+	std::string hex();
+
+private:
+	void processBlock(const uint8_t * block);
+
+	uint32_t state[4];
+	uint64_t length = 0;  // total number of bytes
+	uint8_t buffer[64];
+	size_t bufferUsed = 0;
+};
+
+
+// Size, CRC32, MD5 and SHA-1 of a track or an image, as listed in Redump
+// .dat files, computed incrementally.
+class RedumpHash {
+public:
+	struct Values {
+		uint64_t size = 0;
+		std::string crc, md5, sha1;
+
+		bool operator==(const Values &) const = default;
+
+		// "size <size>  crc <crc>  md5 <md5>  sha1 <sha1>"
+		std::string toString() const;
+	};
+
+	void update(const void * data, size_t size);
+
+	// Finish the computation and return the size and digests. No more data
+	// may be added afterwards.
+	Values finish();
+
+private:
+	uint64_t length = 0;
+	CRC32 crc;
+	MD5 md5;
+	SHA1 sha1;
+};
+
+#endif
@@ -0,0 +1,284 @@
+//
+// PSXImager - Buffered writer for image files
+//
+// Copyright (C) Christian Bauer <www.cebix.net>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+//
+
+#include "imagewriter.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <memory>
+#include <stdexcept>
+namespace fs = std::filesystem;
+using namespace std;
+
+// POSIX systems write with pwritev(), and Linux also supports direct I/O.
+// Elsewhere the data is written through an fstream.
+#if defined(__unix__) || defined(__APPLE__)
+	#define HAVE_PWRITEV 1
+	#include <fcntl.h>
+	#include <sys/uio.h>
+	#include <unistd.h>
+#endif
+
+
+// Create or open the image file.
+ImageWriter::ImageWriter(const fs::path & path_, bool direct_, size_t bufferSize_, Mode mode)
+	: path(path_), bufferSize(max(bufferSize_ / ALIGNMENT, size_t(1)) * ALIGNMENT), direct(direct_)
+{
+	bufferMemory.reset(new uint8_t[bufferSize + ALIGNMENT]);
+	void * p = bufferMemory.get();
+	size_t space = bufferSize + ALIGNMENT;
+	buffer = static_cast<uint8_t *>(align(ALIGNMENT, bufferSize, p, space));
+
+#ifdef HAVE_PWRITEV
+	if (mode == UPDATE) {
+		fd = open(path.c_str(), O_WRONLY | O_CLOEXEC);
+		if (fd < 0) {
+			throw runtime_error(format("Error opening image file {}: {}", path.string(), strerror(errno)));
+		}
+	} else {
+		fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+		if (fd < 0) {
+			throw runtime_error(format("Error creating image file {}: {}", path.string(), strerror(errno)));
+		}
+	}
+
+	// Not all filesystems support direct I/O, the image is written through
+	// the page cache then
+	#ifdef O_DIRECT
+	if (direct) {
+		directFd = open(path.c_str(), O_WRONLY | O_DIRECT | O_CLOEXEC);
+	}
+	#endif
+	if (directFd < 0) {
+		direct = false;
+	}
+#else
+	direct = false;
+	if (mode == UPDATE) {
+		file.open(path, fstream::in | fstream::out | fstream::binary);
+		if (!file) {
+			throw runtime_error(format("Error opening image file {}", path.string()));
+		}
+	} else {
+		file.open(path, fstream::out | fstream::binary | fstream::trunc);
+		if (!file) {
+			throw runtime_error(format("Error creating image file {}", path.string()));
+		}
+	}
+#endif
+}
+
+
+// Close the image file if that hasn't been done yet. Errors are ignored
+// here, call close() to detect them.
+ImageWriter::~ImageWriter()
+{
+	try {
+		close();
+	} catch (...) {
+	}
+}
+
+
+// Append data to the buffer, writing it out whenever it is full.
+void ImageWriter::write(const void * data, size_t size)
+{
+	auto p = static_cast<const uint8_t *>(data);
+
+	// Without direct I/O, data which doesn't fit into the buffer is written
+	// together with the buffered data in one call, without copying it
+	if (!direct && bufferEnd + size > bufferSize) {
+		writeOut(buffer + bufferStart, bufferEnd - bufferStart, p, size, bufferOffset, false);
+		bufferOffset += bufferEnd - bufferStart + size;
+		bufferStart = bufferEnd = 0;
+		return;
+	}
+
+	while (size > 0) {
+		size_t n = min(size, bufferSize - bufferEnd);
+		memcpy(buffer + bufferEnd, p, n);
+		bufferEnd += n;
+		p += n;
+		size -= n;
+
+		if (bufferEnd == bufferSize) {
+			flush();
+		}
+	}
+}
+
+
+// Write out the buffer. With direct I/O, only whole aligned blocks bypass
+// the page cache, partial blocks at the start and end go through it.
+void ImageWriter::flush()
+{
+	size_t size = bufferEnd - bufferStart;
+	uint8_t * p = buffer + bufferStart;
+
+	if (direct) {
+		size_t head = min(size, (ALIGNMENT - bufferStart % ALIGNMENT) % ALIGNMENT);
+		size_t middle = (size - head) / ALIGNMENT * ALIGNMENT;
+
+		writeOut(p, head, nullptr, 0, bufferOffset, false);
+		writeOut(p + head, middle, nullptr, 0, bufferOffset + head, true);
+		writeOut(p + head + middle, size - head - middle, nullptr, 0, bufferOffset + head + middle, false);
+	} else {
+		writeOut(p, size, nullptr, 0, bufferOffset, false);
+	}
+
+	bufferOffset += size;
+	bufferStart = bufferEnd = direct ? size_t(bufferOffset % ALIGNMENT) : 0;
+}
+
+
+// Set the position for the following writes.
+void ImageWriter::seek(uint64_t offset)
+{
+	if (bufferEnd > bufferStart) {
+		flush();
+	}
+	fileEnd = max(fileEnd, bufferOffset);
+
+	bufferOffset = offset;
+	bufferStart = bufferEnd = direct ? size_t(offset % ALIGNMENT) : 0;
+}
+
+
+// Allocate the disk space for the file.
+void ImageWriter::preallocate(uint64_t size)
+{
+#ifdef HAVE_PWRITEV
+	// Not all filesystems support fallocate(), a sparse file will do then
+	int result = -1;
+	#ifdef __linux__
+	result = fallocate(fd, 0, 0, off_t(size));
+	#endif
+	if (result < 0 && ftruncate(fd, off_t(size)) < 0) {
+		throw runtime_error(format("Error extending image file {}: {}", path.string(), strerror(errno)));
+	}
+	preallocated = true;
+#else
+	(void)size;
+#endif
+}
+
+
+// Write out the buffer and close the file.
+void ImageWriter::close()
+{
+#ifdef HAVE_PWRITEV
+	if (fd < 0) {
+		return;
+	}
+
+	// The file is closed even if writing out the buffer fails
+	auto closeFiles = [this] {
+		if (directFd >= 0) {
+			::close(directFd);
+			directFd = -1;
+		}
+		int result = ::close(fd);
+		fd = -1;
+		return result;
+	};
+
+	try {
+		flush();
+
+		fileEnd = max(fileEnd, bufferOffset);
+		if (preallocated && ftruncate(fd, off_t(fileEnd)) < 0) {
+			throw runtime_error(format("Error truncating image file {}: {}", path.string(), strerror(errno)));
+		}
+	} catch (...) {
+		closeFiles();
+		throw;
+	}
+
+	if (closeFiles() < 0) {
+		throw runtime_error(format("Error writing to image file {}: {}", path.string(), strerror(errno)));
+	}
+#else
+	if (!file.is_open()) {
+		return;
+	}
+
+	flush();
+
+	file.close();
+	if (!file) {
+		throw runtime_error(format("Error writing to image file {}", path.string()));
+	}
+#endif
+}
+
+
+// Write two consecutive pieces of data at 'offset' of the file. 'aligned'
+// selects direct I/O, for which the data must be aligned.
+void ImageWriter::writeOut(const void * data1, size_t size1, const void * data2, size_t size2, uint64_t offset, bool aligned)
+{
+#ifdef HAVE_PWRITEV
+	iovec iov[2] = {
+		{ const_cast<void *>(data1), size1 },
+		{ const_cast<void *>(data2), size2 },
+	};
+	iovec * v = iov;
+	int count = 2;
+
+	while (count > 0) {
+		if (v->iov_len == 0) {
+			++v;
+			--count;
+			continue;
+		}
+
+		ssize_t n = pwritev(aligned ? directFd : fd, v, count, off_t(offset));
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			} else if (aligned && errno == EINVAL) {
+				aligned = false;  // direct I/O not supported after all
+				continue;
+			}
+			throw runtime_error(format("Error writing to image file {}: {}", path.string(), strerror(errno)));
+		}
+
+		// Skip the written part
+		offset += n;
+		while (count > 0 && size_t(n) >= v->iov_len) {
+			n -= v->iov_len;
+			++v;
+			--count;
+		}
+		if (count > 0) {
+			v->iov_base = static_cast<uint8_t *>(v->iov_base) + n;
+			v->iov_len -= n;
+		}
+	}
+#else
+	file.seekp(offset);
+	file.write(static_cast<const char *>(data1), size1);
+	file.write(static_cast<const char *>(data2), size2);
+	if (!file) {
+		throw runtime_error(format("Error writing to image file {}", path.string()));
+	}
+#endif
+}
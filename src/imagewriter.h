@@ -0,0 +1,117 @@
+//
+// PSXImager - Buffered writer for image files
+//
+// Copyright (C) Christian Bauer <www.cebix.net>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+//
+
+#ifndef PSXIMAGER_IMAGEWRITER_H
+#define PSXIMAGER_IMAGEWRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+
+
+// Writer for image files which collects the written data in a large
+// buffer and writes it out with few positional write calls. Optionally the
+// data is written with direct I/O (O_DIRECT), which keeps large images
+// from pushing everything else out of the page cache. Data can be written
+// at any offset, consecutive writes are combined. An ImageWriter must only
+// be used by one thread at a time. Throws a runtime_error if an I/O error
+// occurs.
+class ImageWriter {
+public:
+	// How the file is opened
+	enum Mode {
+		CREATE,  // create the file, or truncate an existing one
+		UPDATE,  // overwrite parts of an existing file
+	};
+
+	static constexpr size_t DEFAULT_BUFFER_SIZE = 4 * 1024 * 1024;
+
+	// Open the file 'path'
+	ImageWriter(const std::filesystem::path & path, bool direct = false, size_t bufferSize = DEFAULT_BUFFER_SIZE, Mode mode = CREATE);
+	~ImageWriter();
+
+	ImageWriter(const ImageWriter &) = delete;
+	ImageWriter & operator=(const ImageWriter &) = delete;
+
+	// Append data at the current position
+	void write(const void * data, size_t size);
+
+	// Write data at 'offset'
+	void writeAt(uint64_t offset, const void * data, size_t size)
+	{
+		if (offset != position()) {
+			seek(offset);
+		}
+		write(data, size);
+	}
+
+	// Reserve disk space for the final size of the file, which can then be
+	// written in any order without fragmenting it. When the file is closed,
+	// it is cut back to the highest position reached.
+	void preallocate(uint64_t size);
+
+	// Write out all buffered data
+	void flush();
+
+	// Continue writing at 'offset', e.g. after data was added to the file
+	// by other means
+	void seek(uint64_t offset);
+
+	// Offset of the next byte to be written
+	uint64_t position() const { return bufferOffset + (bufferEnd - bufferStart); }
+
+	// Write out all buffered data and close the file
+	void close();
+
+private:
+	void writeOut(const void * data1, size_t size1, const void * data2, size_t size2, uint64_t offset, bool aligned);
+
+	std::filesystem::path path;
+
+	// Alignment of buffer, file offsets and sizes for direct I/O
+	static constexpr size_t ALIGNMENT = 4096;
+
+	// The buffer holds the data for the file range starting at
+	// 'bufferOffset'. With direct I/O, the data starts at 'bufferStart' so
+	// that it has the same alignment in memory as in the file.
+	std::unique_ptr<uint8_t[]> bufferMemory;
+	uint8_t * buffer;
+	size_t bufferSize;
+	size_t bufferStart = 0;
+	size_t bufferEnd = 0;
+	uint64_t bufferOffset = 0;
+
+	// Highest position reached by previous writes or seeks
+	uint64_t fileEnd = 0;
+	bool preallocated = false;
+
+	bool direct;
+
+#if defined(__unix__) || defined(__APPLE__)
+	int fd = -1;
+	int directFd = -1;  // same file opened with O_DIRECT
+#else
+	std::fstream file;
+#endif
+};
+
+#endif
@@ -0,0 +1,186 @@
+//
+// PSXImager - In-memory ISO 9660 directory tree
+//
+// Copyright (C) Christian Bauer <www.cebix.net>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+//
+
+#include <cdio/logging.h>
+
+#include "isotree.h"
+
+#include <cstddef>
+#include <format>
+#include <new>
+#include <stdexcept>
+using namespace std;
+
+
+// Read the directory tree of the image.
+ISOTree::ISOTree(CdIo_t * image)
+{
+	arena = iso9660_stat_arena_new();
+	if (!arena) {
+		throw bad_alloc();
+	}
+
+	try {
+		load(image);
+	} catch (...) {
+		iso9660_stat_arena_free(arena);
+		throw;
+	}
+}
+
+
+// Free the directory records.
+ISOTree::~ISOTree()
+{
+	iso9660_stat_arena_free(arena);
+}
+
+
+// Read all directory extents, starting at the root directory. Each
+// directory is read with a single request when its node is reached in
+// breadth-first order, which is also the order in which mastering tools
+// lay out the directories on the disc.
+void ISOTree::load(CdIo_t * image)
+{
+	if (!iso9660_fs_read_superblock(image, ISO_EXTENSION_NONE)) {
+		throw runtime_error("Error reading ISO 9660 volume information");
+	}
+
+	iso9660_pvd_t pvd;
+	if (!iso9660_fs_read_pvd(image, &pvd)) {
+		throw runtime_error("Error reading ISO 9660 volume information");
+	}
+
+	// Path of each node, used for the path index and for error messages
+	vector<string> paths;
+
+	auto addNode = [&](iso9660_stat_t * stat, uint32_t parent, lsn_t recordLSN, uint32_t recordOffset) {
+		string name = stat->filename;
+		if (stat->type == iso9660_stat_s::_STAT_FILE) {
+			size_t versionSep = name.find_last_of(';');
+			if (versionSep != string::npos) {
+				name = name.substr(0, versionSep);  // strip version number
+			}
+		}
+
+		uint32_t index = uint32_t(nodes.size());
+		nodes.push_back({ stat, parent, 0, 0, uint32_t(names.size()), uint32_t(name.size()), recordLSN, recordOffset });
+		names += name;
+
+		if (index == ROOT) {
+			paths.emplace_back();
+		} else if (name == "." || name == "..") {
+			paths.emplace_back(paths[parent]);
+		} else {
+			paths.push_back(paths[parent].empty() ? name : (paths[parent] + "/" + name));
+			pathIndex.emplace(paths.back(), index);
+		}
+	};
+
+	// The root directory record is in the PVD
+	iso9660_stat_t * rootStat = iso9660_fs_dir_to_stat_arena(image, &pvd.root_directory_record, arena);
+	if (!rootStat) {
+		throw runtime_error("Error reading ISO 9660 root directory record");
+	}
+	addNode(rootStat, ROOT, ISO_PVD_SECTOR, offsetof(iso9660_pvd_t, root_directory_record));
+	pathIndex.emplace("", ROOT);
+
+	vector<uint8_t> dirBuffer;
+
+	for (uint32_t index = 0; index < nodes.size(); ++index) {
+		const iso9660_stat_t * stat = nodes[index].stat;
+		if (stat->type != iso9660_stat_s::_STAT_DIR) {
+			continue;
+		}
+
+		string_view nodeName = name(index);
+		if (index != ROOT && (nodeName == "." || nodeName == "..")) {
+			continue;
+		}
+
+		// A directory whose extent is also that of one of its ancestors
+		// would be loaded endlessly. Several records pointing to the same
+		// extent elsewhere in the tree (as found on some protected discs)
+		// are aliases, whose entries are loaded once for every name.
+		for (uint32_t ancestor = index; ancestor != ROOT; ) {
+			ancestor = nodes[ancestor].parent;
+			if (nodes[ancestor].stat->lsn == stat->lsn) {
+				throw runtime_error(format("ISO 9660 directory '{}' is part of a loop", paths[index]));
+			}
+		}
+
+		// Read the entire directory extent
+		cdio_info("Reading directory '%s' at LBN %d, %d sectors", paths[index].c_str(), stat->lsn, stat->secsize);
+
+		size_t extentSize = size_t(stat->secsize) * ISO_BLOCKSIZE;
+		if (extentSize == 0) {
+			throw runtime_error(format("Error reading ISO 9660 directory '{}'", paths[index]));
+		}
+
+		dirBuffer.resize(extentSize);
+		driver_return_code_t r = cdio_read_data_sectors(image, dirBuffer.data(), stat->lsn, ISO_BLOCKSIZE, stat->secsize);
+		if (r != DRIVER_OP_SUCCESS) {
+			throw runtime_error(format("Error reading ISO 9660 directory '{}': {}", paths[index], cdio_driver_errmsg(r)));
+		}
+
+		// Append its entries to the tree
+		lsn_t dirLSN = stat->lsn;
+		uint32_t firstChild = uint32_t(nodes.size());
+
+		size_t offset = 0;
+		while (offset < extentSize) {
+			size_t recLen = dirBuffer[offset];
+
+			// A zero length or a record crossing the sector boundary
+			// ends the records in this sector
+			if (recLen == 0 || (offset + recLen - 1) / ISO_BLOCKSIZE != offset / ISO_BLOCKSIZE) {
+				offset += ISO_BLOCKSIZE - (offset % ISO_BLOCKSIZE);
+				continue;
+			}
+
+			auto record = reinterpret_cast<const iso9660_dir_t *>(dirBuffer.data() + offset);
+			iso9660_stat_t * entry = iso9660_fs_dir_to_stat_arena(image, record, arena);
+			if (!entry) {
+				throw runtime_error(format("Invalid record in ISO 9660 directory '{}' at offset {}", paths[index], offset));
+			}
+
+			addNode(entry, index, dirLSN + lsn_t(offset / ISO_BLOCKSIZE), uint32_t(offset % ISO_BLOCKSIZE));
+			offset += recLen;
+		}
+
+		nodes[index].firstChild = firstChild;
+		nodes[index].numChildren = uint32_t(nodes.size()) - firstChild;
+	}
+}
+
+
+// Return the index of the node with the given path, or NOT_FOUND.
+uint32_t ISOTree::find(string_view path) const
+{
+	while (!path.empty() && path.front() == '/') {
+		path.remove_prefix(1);
+	}
+	while (!path.empty() && path.back() == '/') {
+		path.remove_suffix(1);
+	}
+
+	auto i = pathIndex.find(string(path));
+	return i == pathIndex.end() ? NOT_FOUND : i->second;
+}
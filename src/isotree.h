@@ -0,0 +1,90 @@
+//
+// PSXImager - In-memory ISO 9660 directory tree
+//
+// Copyright (C) Christian Bauer <www.cebix.net>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+//
+
+#ifndef PSXIMAGER_ISOTREE_H
+#define PSXIMAGER_ISOTREE_H
+
+#include <cdio/cdio.h>
+#include <cdio/iso9660.h>
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+
+// Directory hierarchy of the ISO 9660 filesystem of an image, loaded by
+// reading every directory extent with a single request. A directory
+// extent which is referenced by several records is loaded once for each
+// of them, so its entries appear under every name. The nodes are stored in
+// breadth-first order in a single array, so the entries of a directory
+// (including "." and "..") are contiguous and in directory record order.
+// Node 0 is the root directory. The directory records of all nodes are
+// allocated from one arena which is released with the tree.
+class ISOTree {
+public:
+	struct Node {
+		iso9660_stat_t * stat;  // contents of the directory record
+		uint32_t parent;        // index of the containing directory
+		uint32_t firstChild;    // index of the first entry, for directories
+		uint32_t numChildren;   // number of entries, for directories
+		uint32_t nameOffset;    // name in the name table
+		uint32_t nameLength;
+		lsn_t recordLSN;        // sector holding the directory record
+		uint32_t recordOffset;  // offset of the record in that sector
+	};
+
+	static constexpr uint32_t ROOT = 0;
+	static constexpr uint32_t NOT_FOUND = UINT32_MAX;
+
+	// Read the directory tree of the image. Throws a runtime_error if the
+	// filesystem cannot be read.
+	explicit ISOTree(CdIo_t * image);
+	~ISOTree();
+
+	ISOTree(const ISOTree &) = delete;
+	ISOTree & operator=(const ISOTree &) = delete;
+
+	uint32_t size() const { return uint32_t(nodes.size()); }
+
+	const Node & node(uint32_t index) const { return nodes[index]; }
+	Node & node(uint32_t index) { return nodes[index]; }
+
+	// Name of a node. The version number of file names is stripped.
+	std::string_view name(uint32_t index) const
+	{
+		return std::string_view(names).substr(nodes[index].nameOffset, nodes[index].nameLength);
+	}
+
+	// Return the index of the node with the given path (e.g. "DIR/FILE.EXT",
+	// without version number), or NOT_FOUND.
+	uint32_t find(std::string_view path) const;
+
+private:
+	void load(CdIo_t * image);
+
+	iso9660_stat_arena_t * arena;
+	std::vector<Node> nodes;
+	std::string names;
+	std::unordered_map<std::string, uint32_t> pathIndex;
+};
+
+#endif
@@ -228,6 +228,7 @@ struct  iso9660_ltime_s {
 typedef struct iso9660_ltime_s  iso9660_ltime_t;
 typedef struct iso9660_dir_s    iso9660_dir_t;
 typedef struct iso9660_stat_s   iso9660_stat_t;
+typedef struct iso9660_stat_arena_s iso9660_stat_arena_t;
 
 #include <cdio/rock.h>
 
@@ -1071,6 +1072,48 @@ void iso9660_dirlist_free(CdioISO9660DirList_t *p_filelist);
 */
 CdioList_t * iso9660_fs_readdir (CdIo_t *p_cdio, const char psz_path[]);
 
+/*!
+  Convert a directory record read from p_cdio into an iso9660_stat_t,
+  the same way iso9660_fs_readdir() does for each entry. This allows a
+  caller to read directory extents itself, without the path lookup
+  from the root done by iso9660_fs_readdir().
+
+  @param p_cdio the CD object the record was read from
+
+  @param p_iso9660_dir the directory record
+
+  @return file status for the record, or NULL on error. The caller
+  must free the returned result using iso9660_stat_free().
+*/
+iso9660_stat_t * iso9660_fs_dir_to_stat (const CdIo_t *p_cdio,
+                                         const iso9660_dir_t *p_iso9660_dir);
+
+/*!
+  Create an arena from which iso9660_stat_t records can be allocated.
+  Records are carved out of large blocks and freed all at once by
+  iso9660_stat_arena_free(), which avoids an allocation per directory
+  entry when reading large directory trees.
+
+  @return the new arena, or NULL if memory allocation fails.
+*/
+iso9660_stat_arena_t * iso9660_stat_arena_new (void);
+
+/*!
+  Free an arena together with all records allocated from it.
+*/
+void iso9660_stat_arena_free (iso9660_stat_arena_t *p_arena);
+
+/*!
+  Like iso9660_fs_dir_to_stat(), but allocate the result from p_arena.
+
+  @return file status for the record, or NULL on error. The result
+  must not be passed to iso9660_stat_free(); it remains valid until
+  the arena is freed.
+*/
+iso9660_stat_t * iso9660_fs_dir_to_stat_arena (const CdIo_t *p_cdio,
+                                               const iso9660_dir_t *p_iso9660_dir,
+                                               iso9660_stat_arena_t *p_arena);
+
 /*!
   Read psz_path (a directory) and return a list of iso9660_stat_t
   pointers for the files inside that directory.
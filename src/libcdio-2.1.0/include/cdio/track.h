@@ -259,6 +259,56 @@ extern "C" {
 
   unsigned int cdio_get_track_end_sector(const CdIo_t *p_cdio, track_t u_track);
 
+  /*!
+    Return a pointer to i_blocks consecutive raw (2352 byte) frames
+    starting at i_lsn, without copying them.
+
+    This is only available for BIN/CUE images opened with one of the
+    "mmap" access modes (see cdio_open_am()). The frames must lie in one
+    .bin file. The pointer remains valid until the image is closed.
+
+    @return a pointer to the frames or NULL if they are not available in
+    this way. Use cdio_read_audio_sectors() then.
+  */
+  const uint8_t *cdio_get_raw_sectors(const CdIo_t *p_cdio, lsn_t i_lsn,
+                                      uint32_t i_blocks);
+
+  /*!
+    Return in *ppsz_filename the name of the file holding the raw (2352
+    byte) frame at i_lsn, and in *pi_offset the byte offset of the frame
+    in that file.
+
+    This lets a caller move runs of frames between files without
+    copying them through memory, e.g. with copy_file_range(). Frames
+    i_lsn + n are at *pi_offset + n * 2352 as long as the same file name
+    is returned for them. The name remains valid until the image is
+    closed. This is available for BIN/CUE images.
+
+    @return DRIVER_OP_SUCCESS if no error, DRIVER_OP_UNSUPPORTED if the
+    driver does not keep the frames in files.
+  */
+  driver_return_code_t cdio_get_raw_sector_file(const CdIo_t *p_cdio,
+                                                lsn_t i_lsn,
+                                                const char **ppsz_filename,
+                                                uint64_t *pi_offset);
+
+  /*!
+    Read i_blocks consecutive raw (2352 byte) frames starting at i_lsn
+    into p_buf.
+
+    Unlike cdio_read_audio_sectors() and the other read functions, this
+    does not move a file position shared by all users of p_cdio, so any
+    number of threads may call it on the same CdIo_t object at once. It
+    must not run concurrently with functions which change the object,
+    such as cdio_destroy(). This is available for BIN/CUE images.
+
+    @return DRIVER_OP_SUCCESS if no error, DRIVER_OP_UNSUPPORTED if the
+    driver does not provide positional reads.
+  */
+  driver_return_code_t cdio_pread_raw_sectors(const CdIo_t *p_cdio,
+                                              void *p_buf, lsn_t i_lsn,
+                                              uint32_t i_blocks);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -284,6 +284,23 @@ extern "C" {
     */
     track_t (*get_num_tracks) ( void *p_env );
 
+    /*!
+      Return a pointer to i_blocks consecutive raw (2352 byte) frames
+      starting at i_lsn if the driver can hand them out without copying,
+      e.g. from a memory-mapped image. NULL is returned otherwise.
+    */
+    const uint8_t * (*get_raw_sectors) ( void *p_env, lsn_t i_lsn,
+                                         unsigned int i_blocks );
+
+    /*!
+      Return in *ppsz_filename the file holding the raw (2352 byte)
+      frame of i_lsn and in *pi_offset the byte offset of the frame in
+      it. Returns DRIVER_OP_SUCCESS if no error.
+    */
+    driver_return_code_t (*get_raw_sector_file) ( void *p_env, lsn_t i_lsn,
+                                                  const char **ppsz_filename,
+                                                  uint64_t *pi_offset );
+
     /*! Return number of channels in track: 2 or 4; -2 if not
       implemented or -1 for error.
       Not meaningful if track is not an audio track.
@@ -370,6 +387,16 @@ extern "C" {
     */
     off_t (*lseek) ( void *p_env, off_t offset, int whence );
 
+    /*!
+      Reads i_blocks raw (2352 byte) frames starting at i_lsn into
+      p_buf without a shared file position, so that several threads
+      can call it on the same object at once.
+      Returns DRIVER_OP_SUCCESS if no error.
+    */
+    driver_return_code_t (*pread_raw_sectors) ( void *p_env, void *p_buf,
+                                                lsn_t i_lsn,
+                                                unsigned int i_blocks );
+
     /*!
       Reads into buf the next size bytes.
       Returns -1 on error.
@@ -40,6 +40,9 @@
 #ifdef HAVE_STDLIB_H
 #include <stdlib.h>
 #endif
+#ifdef HAVE_LIMITS_H
+#include <limits.h>
+#endif
 #ifdef HAVE_STRING_H
 #include <string.h>
 #endif
@@ -63,6 +66,13 @@
 
 #include <ctype.h>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #include <cdio/logging.h>
 #include <cdio/util.h>
 #include <cdio/utf8.h>
@@ -78,6 +88,17 @@
 #define DEFAULT_CDIO_DEVICE "videocd.bin"
 #define DEFAULT_CDIO_CUE    "videocd.cue"
 
+/* Maximum number of raw frames fetched from the .bin file with one stream
+   read. Larger requests are split into reads of this size. */
+#define BINCUE_MAX_READ_BLOCKS 512
+
+/* Number of raw frames in a block of the sector cache, and the default
+   memory cap of the cache. The cap can be changed with the "cache-size"
+   argument. */
+#define BINCUE_CACHE_BLOCK_FRAMES 64
+#define BINCUE_CACHE_BLOCK_SIZE   (BINCUE_CACHE_BLOCK_FRAMES * CDIO_CD_FRAMESIZE_RAW)
+#define BINCUE_CACHE_DEFAULT_SIZE (2 * 1024 * 1024)
+
 #ifdef _WIN32
 #define CDIO_FOPEN fopen_utf8
 #else
@@ -88,6 +109,81 @@ static lsn_t get_disc_last_lsn_bincue(void *p_user_data);
 #include "image_common.h"
 static bool parse_cuefile(_img_private_t *cd, const char *toc_name);
 
+/* How the .bin files are accessed. Selected with the access mode passed to
+   cdio_open_am_bincue(). */
+typedef enum {
+  BINCUE_ACCESS_STDIO,            /* "bincue": stdio streams */
+  BINCUE_ACCESS_MMAP,             /* "mmap": memory-mapped */
+  BINCUE_ACCESS_MMAP_SEQUENTIAL,  /* "mmap-sequential": memory-mapped,
+                                     mostly read front to back */
+  BINCUE_ACCESS_MMAP_RANDOM       /* "mmap-random": memory-mapped,
+                                     scattered lookups */
+} bincue_access_t;
+
+/* A .bin file mapped into memory */
+typedef struct {
+  uint8_t *base;
+  size_t   size;
+} bincue_map_t;
+
+/* A .bin file of the image. The stdio stream is opened on first use and
+   stays open until the image is freed. Unmapped files also get a handle for
+   positional reads when the image is opened. */
+typedef struct {
+  const char       *psz_filename;  /* from tocent, not owned */
+  lsn_t             base;          /* LSN of the first frame in the file */
+  CdioDataSource_t *source;
+  bincue_map_t      map;
+#ifdef _WIN32
+  HANDLE            h_pread;
+#else
+  int               fd_pread;
+#endif
+} bincue_file_t;
+
+/* The LSNs of a track (including its pregap) and the file holding them */
+typedef struct {
+  lsn_t start;
+  lsn_t end;
+  int   i_file;                    /* index into files[] */
+} bincue_range_t;
+
+/* A block of raw frames held in the sector cache */
+typedef struct {
+  lsn_t        start;              /* multiple of BINCUE_CACHE_BLOCK_FRAMES */
+  unsigned int i_frames;           /* number of valid frames */
+  uint64_t     last_use;           /* use counter at the last access */
+  uint8_t     *data;
+} bincue_cache_block_t;
+
+/* LRU cache of blocks of raw frames. It is only used for small reads
+   through the stdio streams, which are mostly of filesystem metadata;
+   memory-mapped images and reads of a whole block or more bypass it. */
+typedef struct {
+  unsigned int          i_max_blocks;  /* memory cap in blocks, 0 = off */
+  unsigned int          i_blocks;
+  bincue_cache_block_t *blocks;
+  uint64_t              use_counter;
+  uint64_t              hits;
+  uint64_t              misses;
+  char                  arg_buf[3][24];  /* values returned by get_arg */
+} bincue_cache_t;
+
+/* Private driver data. The common image code only sees the first member. */
+typedef struct {
+  _img_private_t  img;
+  bincue_access_t access;
+  bool            b_single_file;   /* all tracks in files[0], LSNs as is */
+  int             i_files;
+  bincue_file_t   files[CDIO_CD_MAX_TRACKS+1];
+  int             i_ranges;
+  bincue_range_t  ranges[CDIO_CD_MAX_TRACKS+1];  /* sorted by start */
+  int             i_cur_file;      /* file gen.data_source belongs to */
+  bincue_cache_t  cache;
+} _bincue_private_t;
+
+static void _build_file_table_bincue (_bincue_private_t *p_bincue);
+
 #ifdef _WIN32
 #include <windows.h>
 
@@ -176,6 +272,8 @@ _init_bincue(_img_private_t *p_env)
     cdio_lsn_to_lba(lead_lsn -
                     p_env->tocent[p_env->gen.i_tracks - p_env->gen.i_first_track].start_lba);
 
+  _build_file_table_bincue((_bincue_private_t *) p_env);
+
   return true;
 }
 
@@ -228,55 +326,89 @@ _lseek_bincue (void *p_user_data, off_t offset, int whence)
 /*!
   Reads into buf the next size bytes.
   Returns -1 on error.
-  FIXME:
-   At present we assume a read doesn't cross sector or track
-   boundaries.
+  The payloads of all sectors spanned by the request, together with the
+  headers and trailers between them, are fetched with one stream read per
+  BINCUE_MAX_READ_BLOCKS sectors and then copied out. The read buffer is
+  sized to the raw span of the request, so small reads stay cheap.
 */
 static ssize_t
 _read_bincue (void *p_user_data, void *data, size_t size)
 {
   _img_private_t *p_env = p_user_data;
-  char buf[CDIO_CD_FRAMESIZE_RAW] = { 0, };
+  struct { size_t raw_offset; size_t size; } piece[BINCUE_MAX_READ_BLOCKS];
+  char *buf = NULL;
+  size_t buf_size = 0;
   char *p = data;
   ssize_t final_size=0;
-  ssize_t this_size;
-  track_info_t  *this_track=&(p_env->tocent[p_env->pos.index]);
-  ssize_t skip_size = this_track->datastart + this_track->endsize;
 
   while (size > 0) {
-    long int rem = (long int) (this_track->datasize - p_env->pos.buff_offset);
-    if ((long int) size <= rem) {
-      this_size = cdio_stream_read(p_env->gen.data_source, buf, size, 1);
-      final_size += this_size;
-      memcpy (p, buf, this_size);
-      break;
+    unsigned int index = p_env->pos.index;
+    lba_t lba = p_env->pos.lba;
+    size_t buff_offset = p_env->pos.buff_offset;
+    size_t raw_size = 0;
+    ssize_t read_size;
+    unsigned int n = 0, i;
+
+    /* Lay out the sector payloads covered by this read. */
+    while (size > 0 && n < BINCUE_MAX_READ_BLOCKS) {
+      track_info_t *this_track = &(p_env->tocent[index]);
+      size_t rem = this_track->datasize - buff_offset;
+
+      if (rem > 0) {
+        size_t this_size = size < rem ? size : rem;
+        piece[n].raw_offset = raw_size;
+        piece[n].size = this_size;
+        n++;
+        raw_size += this_size;
+        buff_offset += this_size;
+        size -= this_size;
+        if (size == 0) break;
+      }
+
+      /* Skip over stuff at end of this sector and the beginning of the next.
+       */
+      raw_size += this_track->endsize;
+      buff_offset = 0;
+      lba++;
+
+      /* Have gone into next track. */
+      if (index + 1 < p_env->gen.i_tracks
+          && lba >= p_env->tocent[index+1].start_lba)
+        index++;
+      raw_size += p_env->tocent[index].datastart;
     }
 
-    /* Finish off reading this sector. */
-    cdio_warn ("Reading across block boundaries not finished");
+    if (raw_size > buf_size) {
+      char *new_buf = realloc (buf, raw_size);
+      if (!new_buf) {
+        final_size = -1;
+        break;
+      }
+      buf = new_buf;
+      buf_size = raw_size;
+    }
 
-    size -= rem;
-    this_size = cdio_stream_read(p_env->gen.data_source, buf, rem, 1);
-    final_size += this_size;
-    memcpy (p, buf, this_size);
-    p += this_size;
-    cdio_stream_read(p_env->gen.data_source, buf, rem, 1);
+    read_size = cdio_stream_read(p_env->gen.data_source, buf, raw_size, 1);
+    if (read_size < 0) read_size = 0;
 
-    /* Skip over stuff at end of this sector and the beginning of the next.
-     */
-    cdio_stream_read(p_env->gen.data_source, buf, skip_size, 1);
+    for (i = 0; i < n && piece[i].raw_offset < (size_t) read_size; i++) {
+      size_t this_size = piece[i].size;
+      if (piece[i].raw_offset + this_size > (size_t) read_size)
+        this_size = read_size - piece[i].raw_offset;
+      memcpy (p, buf + piece[i].raw_offset, this_size);
+      p += this_size;
+      final_size += this_size;
+    }
+
+    if ((size_t) read_size < raw_size) break;
 
     /* Get ready to read another sector. */
-    p_env->pos.buff_offset=0;
-    p_env->pos.lba++;
-
-    /* Have gone into next track. */
-    if (p_env->pos.lba >= p_env->tocent[p_env->pos.index+1].start_lba) {
-      p_env->pos.index++;
-      this_track=&(p_env->tocent[p_env->pos.index]);
-      skip_size = this_track->datastart + this_track->endsize;
-    }
+    p_env->pos.index = index;
+    p_env->pos.lba = lba;
+    p_env->pos.buff_offset = buff_offset;
   }
+
+  free (buf);
   return final_size;
 }
 
@@ -1040,184 +1172,780 @@ parse_cuefile (_img_private_t *cd, const char *psz_cue_name)
 
 }
 
-/* Checks if the LSN is within the active file's range, and updates the data source if not. */
+/*!
+  Builds the table of .bin files and the LSN ranges of the tracks in them,
+  so that _find_file_bincue() does not have to scan the tracks and compare
+  file names on every read. Tracks without a FILE line of their own are in
+  the file of the previous track.
+ */
+static void
+_build_file_table_bincue (_bincue_private_t *p_bincue)
+{
+  _img_private_t *p_env = &p_bincue->img;
+  int i, j, i_file = -1;
+
+  p_bincue->i_files = 0;
+  p_bincue->i_ranges = 0;
+  p_bincue->i_cur_file = -1;
+
+  /* Filename == NULL for tracks 2+ on a 1 file .bin / .cue combo.
+     The LSN is already relative to the start of the only file. */
+  p_bincue->b_single_file = (p_env->gen.i_tracks > p_env->gen.i_first_track
+                             && p_env->tocent[p_env->gen.i_first_track].filename == NULL);
+  if (p_bincue->b_single_file) {
+    p_bincue->files[0].psz_filename = p_env->tocent[0].filename;
+    p_bincue->i_files = 1;
+  } else {
+    for (i = 0; i < p_env->gen.i_tracks; i++) {
+      const char *psz_filename = p_env->tocent[i].filename;
+      bincue_range_t range;
+
+      range.start = p_env->tocent[i].start_lba - p_env->tocent[i].pregap;
+      range.end = range.start + (p_env->tocent[i].sec_count - 1);
+
+      if (psz_filename != NULL) {
+        for (i_file = 0; i_file < p_bincue->i_files; i_file++)
+          if (strcmp(p_bincue->files[i_file].psz_filename, psz_filename) == 0)
+            break;
+        if (i_file == p_bincue->i_files) {
+          p_bincue->files[i_file].psz_filename = psz_filename;
+          p_bincue->files[i_file].base = range.start;
+          p_bincue->i_files++;
+        }
+      }
+
+      if (i_file < 0 || range.end < range.start)
+        continue;
+
+      /* Insert sorted by start LSN */
+      range.i_file = i_file;
+      for (j = p_bincue->i_ranges; j > 0 && p_bincue->ranges[j-1].start > range.start; j--)
+        p_bincue->ranges[j] = p_bincue->ranges[j-1];
+      p_bincue->ranges[j] = range;
+      p_bincue->i_ranges++;
+    }
+
+    /* Where ranges overlap, the LSNs belong to the earlier range */
+    for (i = 0, j = 0; i < p_bincue->i_ranges; i++) {
+      bincue_range_t range = p_bincue->ranges[i];
+      if (j > 0 && range.start <= p_bincue->ranges[j-1].end)
+        range.start = p_bincue->ranges[j-1].end + 1;
+      if (range.start <= range.end)
+        p_bincue->ranges[j++] = range;
+    }
+    p_bincue->i_ranges = j;
+  }
+
+  for (i_file = 0; i_file < p_bincue->i_files; i_file++) {
+#ifdef _WIN32
+    p_bincue->files[i_file].h_pread = INVALID_HANDLE_VALUE;
+#else
+    p_bincue->files[i_file].fd_pread = -1;
+#endif
+  }
+
+  /* The stream opened by _init_bincue() is the first one cached */
+  for (i_file = 0; i_file < p_bincue->i_files; i_file++) {
+    bincue_file_t *p_file = &p_bincue->files[i_file];
+    if (p_file->psz_filename != NULL && p_env->gen.source_name != NULL
+        && strcmp(p_file->psz_filename, p_env->gen.source_name) == 0) {
+      p_file->source = p_env->gen.data_source;
+      p_bincue->i_cur_file = i_file;
+      break;
+    }
+  }
+}
+
+/* Finds the .bin file holding the given LSN by binary search over the
+   track ranges. Returns its index in files[] and makes the LSN relative to
+   the start of the file, or returns -1 if the LSN is out of range. */
+static int
+_find_file_bincue(const _img_private_t *p_env, lsn_t *lsn)
+{
+  const _bincue_private_t *p_bincue = (const _bincue_private_t *) p_env;
+  int lo = 0, hi = p_bincue->i_ranges - 1;
+
+  if (p_bincue->b_single_file)
+    return 0;
+
+  while (lo <= hi) {
+    int mid = lo + (hi - lo) / 2;
+    const bincue_range_t *p_range = &p_bincue->ranges[mid];
+
+    if (*lsn < p_range->start) {
+      hi = mid - 1;
+    } else if (*lsn > p_range->end) {
+      lo = mid + 1;
+    } else {
+      *lsn -= p_bincue->files[p_range->i_file].base;
+      return p_range->i_file;
+    }
+  }
+
+  return -1;
+}
+
+/* Checks if the LSN is within the active file's range, and updates the data
+   source if not. The streams of all files stay open once used, so reads
+   alternating between tracks do not reopen files. */
 static bool
 _switch_data_source_if_needed(_img_private_t *p_env, lsn_t *lsn)
 {
-  int track;
+  _bincue_private_t *p_bincue = (_bincue_private_t *) p_env;
+  bincue_file_t *p_file;
   int lsnRequest = *lsn;
+  int i = _find_file_bincue(p_env, lsn);
 
-  /* Filename == NULL for tracks 2+ on a 1 file .bin / .cue combo.
-     Just return true to prevent relative lsn processing and file reloading. */
-  if (p_env->gen.i_tracks > p_env->gen.i_first_track && p_env->tocent[p_env->gen.i_first_track].filename == NULL) {
+  if (i < 0) {
+    /* LSN not found in any track */
+    cdio_warn("LSN %d out of range in the available tracks", lsnRequest);
+    return false;
+  }
+
+  /* If we're already using the correct file, return true */
+  if (i == p_bincue->i_cur_file) {
     return true;
   }
 
-  /* Iterate over all tracks to find the correct file for the given LSN */
-  for (track = p_env->gen.i_first_track; track <= p_env->gen.i_tracks; track++) {
-    lsn_t start_lba = p_env->tocent[track - p_env->gen.i_first_track].start_lba - p_env->tocent[track - p_env->gen.i_first_track].pregap;
-    lsn_t sec_count = p_env->tocent[track - p_env->gen.i_first_track].sec_count;
-    lsn_t end_lba = start_lba + (sec_count - 1);
-
-    /* Check if the given LSN falls within this track's LBA range */
-    if (*lsn >= start_lba && *lsn <= end_lba) {
-      /* If we're already using the correct file, return true */
-      if (strcmp(p_env->gen.source_name, p_env->tocent[track - p_env->gen.i_first_track].filename) == 0) {
-        *lsn -= start_lba;  // Adjust LSN relative to the start of this track
-        return true;
-      }
+  p_file = &p_bincue->files[i];
+  if (!p_file->source) {
+    p_file->source = cdio_stdio_new(p_file->psz_filename);
+    if (!p_file->source) {
+      cdio_warn("Failed to open the .bin file: %s", p_file->psz_filename);
+      return false;
+    }
+  }
 
-      /* Update source_name and data_source to the correct file */
-      free(p_env->gen.source_name);
-      p_env->gen.source_name = strdup(p_env->tocent[track - p_env->gen.i_first_track].filename);
+  /* A stream that is not in the file table is not needed any more */
+  if (p_bincue->i_cur_file < 0 && p_env->gen.data_source) {
+    cdio_stdio_destroy(p_env->gen.data_source);
+  }
 
-      /* Reinitialize the data source with the new file */
-      if (p_env->gen.data_source) {
-        cdio_stream_close(p_env->gen.data_source);
-      }
-      p_env->gen.data_source = cdio_stdio_new(p_env->gen.source_name);
+  /* Update source_name and data_source to the correct file */
+  free(p_env->gen.source_name);
+  p_env->gen.source_name = strdup(p_file->psz_filename);
+  p_env->gen.data_source = p_file->source;
+  p_bincue->i_cur_file = i;
 
-      if (!p_env->gen.data_source) {
-        cdio_warn("Failed to open the .bin file: %s", p_env->gen.source_name);
-        return false;
-      }
-      
-      /* Successfully switched the data source; adjust LSN for the file's offset */
-      *lsn -= start_lba;  // Adjust LSN to be relative to the track start
-      cdio_log(CDIO_LOG_DEBUG, "Switched to file %s for LSN %d. Track file offset LSN %d", p_env->gen.source_name, lsnRequest, *lsn);
-      return true;
-    }
-  }
+  cdio_log(CDIO_LOG_DEBUG, "Switched to file %s for LSN %d. Track file offset LSN %d", p_env->gen.source_name, lsnRequest, *lsn);
+  return true;
+}
 
-  /* LSN not found in any track */
-  cdio_warn("LSN %d out of range in the available tracks", *lsn);
-  return false;
+#ifdef _WIN32
+/*!
+  Opens a .bin file given by its UTF-8 name for reading.
+ */
+static HANDLE
+_open_win32_bincue (const char *psz_filename, DWORD flags)
+{
+  HANDLE h_file;
+  wchar_t *psz_wname;
+  int len = MultiByteToWideChar (CP_UTF8, 0, psz_filename, -1, NULL, 0);
+
+  if (len <= 0 || !(psz_wname = malloc (len * sizeof (wchar_t))))
+    return INVALID_HANDLE_VALUE;
+  MultiByteToWideChar (CP_UTF8, 0, psz_filename, -1, psz_wname, len);
+
+  h_file = CreateFileW (psz_wname, GENERIC_READ, FILE_SHARE_READ, NULL,
+                        OPEN_EXISTING, flags, NULL);
+  free (psz_wname);
+  return h_file;
 }
+#endif
 
 /*!
-   Reads a single audio sector from CD device into data starting
-   from lsn. Returns 0 if no error.
+  Maps a .bin file into memory read-only, and tells the OS how it is going
+  to be accessed. Returns false if the file cannot be mapped.
  */
-static driver_return_code_t
-_read_audio_sectors_bincue (void *p_user_data, void *data, lsn_t lsn,
-                          unsigned int nblocks)
+static bool
+_map_file_bincue (bincue_map_t *p_map, const char *psz_filename,
+                  bincue_access_t access)
 {
-  _img_private_t *p_env = p_user_data;
-  int ret;
+#ifdef _WIN32
+  DWORD flags = FILE_ATTRIBUTE_NORMAL;
+  LARGE_INTEGER size;
+  HANDLE h_file, h_mapping;
+
+  /* Windows has no madvise(), but the cache manager honors the access
+     hints given when opening the file, also for mapped views. */
+  if (access == BINCUE_ACCESS_MMAP_SEQUENTIAL)
+    flags |= FILE_FLAG_SEQUENTIAL_SCAN;
+  else if (access == BINCUE_ACCESS_MMAP_RANDOM)
+    flags |= FILE_FLAG_RANDOM_ACCESS;
+
+  h_file = _open_win32_bincue (psz_filename, flags);
+  if (h_file == INVALID_HANDLE_VALUE)
+    return false;
 
-  /* Ensure the data source is correctly set for the requested LSN */
-  if (!_switch_data_source_if_needed(p_env, &lsn)) {
-    cdio_warn("Failed to switch to the appropriate .bin file for LSN %d", lsn);
+  if (!GetFileSizeEx (h_file, &size) || size.QuadPart == 0
+      || (uint64_t) size.QuadPart > SIZE_MAX) {
+    CloseHandle (h_file);
     return false;
   }
 
-  ret = cdio_stream_seek (p_env->gen.data_source,
-            lsn * CDIO_CD_FRAMESIZE_RAW, SEEK_SET);
-  if (ret!=0) return ret;
+  /* The view keeps the mapping and the file open. */
+  h_mapping = CreateFileMappingW (h_file, NULL, PAGE_READONLY, 0, 0, NULL);
+  CloseHandle (h_file);
+  if (h_mapping == NULL)
+    return false;
 
-  ret = cdio_stream_read (p_env->gen.data_source, data,
-            CDIO_CD_FRAMESIZE_RAW, nblocks);
+  p_map->base = MapViewOfFile (h_mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle (h_mapping);
+  if (p_map->base == NULL)
+    return false;
 
-  /* ret is number of bytes if okay, but we need to return 0 okay. */
-  return ret == 0;
+  p_map->size = (size_t) size.QuadPart;
+  return true;
+#else
+  struct stat st;
+  void *base;
+  int fd = open (psz_filename, O_RDONLY);
+
+  if (fd < 0)
+    return false;
+
+  if (fstat (fd, &st) != 0 || st.st_size == 0
+      || (uintmax_t) st.st_size > SIZE_MAX) {
+    close (fd);
+    return false;
+  }
+
+  /* The read-ahead set here applies to the mapping, which keeps the file
+     open. */
+#ifdef POSIX_FADV_SEQUENTIAL
+  if (access == BINCUE_ACCESS_MMAP_SEQUENTIAL)
+    posix_fadvise (fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+  else if (access == BINCUE_ACCESS_MMAP_RANDOM)
+    posix_fadvise (fd, 0, 0, POSIX_FADV_RANDOM);
+#endif
+
+  base = mmap (NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close (fd);
+  if (base == MAP_FAILED)
+    return false;
+
+#ifdef MADV_SEQUENTIAL
+  if (access == BINCUE_ACCESS_MMAP_SEQUENTIAL)
+    madvise (base, st.st_size, MADV_SEQUENTIAL);
+  else if (access == BINCUE_ACCESS_MMAP_RANDOM)
+    madvise (base, st.st_size, MADV_RANDOM);
+#endif
+
+  p_map->base = base;
+  p_map->size = (size_t) st.st_size;
+  return true;
+#endif
 }
 
 /*!
-   Reads a single mode2 sector from cd device into data starting
-   from lsn. Returns 0 if no error.
+  Unmaps a .bin file mapped with _map_file_bincue().
  */
-static driver_return_code_t
-_read_mode1_sector_bincue (void *p_user_data, void *data, lsn_t lsn,
-                           bool b_form2)
+static void
+_unmap_file_bincue (bincue_map_t *p_map)
 {
-  _img_private_t *p_env = p_user_data;
-  int ret;
-  char buf[CDIO_CD_FRAMESIZE_RAW] = { 0, };
-  int blocksize = CDIO_CD_FRAMESIZE_RAW;
+  if (p_map->base == NULL)
+    return;
+#ifdef _WIN32
+  UnmapViewOfFile (p_map->base);
+#else
+  munmap (p_map->base, p_map->size);
+#endif
+  p_map->base = NULL;
+  p_map->size = 0;
+}
 
-  /* Ensure the data source is correctly set for the requested LSN */
-  if (!_switch_data_source_if_needed(p_env, &lsn)) {
-    cdio_warn("Failed to switch to the appropriate .bin file for LSN %d", lsn);
-    return false;
+/*!
+  Maps all .bin files of the image if a memory-mapped access mode was
+  selected. If a file cannot be mapped, the image falls back to stdio
+  access.
+ */
+static void
+_map_image_bincue (_bincue_private_t *p_bincue)
+{
+  int i;
+
+  if (p_bincue->access == BINCUE_ACCESS_STDIO)
+    return;
+
+  for (i = 0; i < p_bincue->i_files; i++) {
+    const char *psz_filename = p_bincue->files[i].psz_filename;
+    if (psz_filename == NULL)
+      continue;
+
+    if (!_map_file_bincue (&p_bincue->files[i].map, psz_filename, p_bincue->access)) {
+      cdio_warn ("cannot map %s into memory, using stdio access", psz_filename);
+      for (i = 0; i < p_bincue->i_files; i++)
+        _unmap_file_bincue (&p_bincue->files[i].map);
+      p_bincue->access = BINCUE_ACCESS_STDIO;
+      return;
+    }
+  }
+}
+
+/*!
+  Opens a handle for positional reads on every .bin file of the image which
+  is not memory-mapped. This is done when the image is opened so that
+  _pread_raw_sectors_bincue() never has to change the driver state.
+ */
+static void
+_open_pread_bincue (_bincue_private_t *p_bincue)
+{
+  int i;
+
+  for (i = 0; i < p_bincue->i_files; i++) {
+    bincue_file_t *p_file = &p_bincue->files[i];
+    if (p_file->psz_filename == NULL || p_file->map.base != NULL)
+      continue;
+
+#ifdef _WIN32
+    p_file->h_pread = _open_win32_bincue (p_file->psz_filename,
+                                          FILE_ATTRIBUTE_NORMAL);
+    if (p_file->h_pread == INVALID_HANDLE_VALUE)
+#else
+    p_file->fd_pread = open (p_file->psz_filename, O_RDONLY);
+    if (p_file->fd_pread < 0)
+#endif
+      cdio_warn ("cannot open %s for positional reads", p_file->psz_filename);
   }
+}
 
-  ret = cdio_stream_seek (p_env->gen.data_source, lsn * blocksize, SEEK_SET);
-  if (ret!=0) return ret;
+/*!
+  Closes the handles opened by _open_pread_bincue().
+ */
+static void
+_close_pread_bincue (bincue_file_t *p_file)
+{
+#ifdef _WIN32
+  if (p_file->h_pread != INVALID_HANDLE_VALUE)
+    CloseHandle (p_file->h_pread);
+  p_file->h_pread = INVALID_HANDLE_VALUE;
+#else
+  if (p_file->fd_pread >= 0)
+    close (p_file->fd_pread);
+  p_file->fd_pread = -1;
+#endif
+}
 
-  /* FIXME: Not completely sure the below is correct. */
-  ret = cdio_stream_read (p_env->gen.data_source, buf, CDIO_CD_FRAMESIZE_RAW, 1);
-  if (ret==0) return ret;
+/*!
+  Reads size bytes at offset of a .bin file without a file position, so
+  that any number of threads can read the file at the same time. Returns
+  the number of bytes read, which is less than size at the end of the file,
+  or -1 on error.
+ */
+static ssize_t
+_pread_file_bincue (const bincue_file_t *p_file, void *buf, size_t size,
+                    uint64_t offset)
+{
+#ifdef _WIN32
+  OVERLAPPED ov;
+  DWORD got = 0;
+
+  if (p_file->h_pread == INVALID_HANDLE_VALUE)
+    return -1;
+
+  memset (&ov, 0, sizeof (ov));
+  ov.Offset = (DWORD) (offset & 0xffffffff);
+  ov.OffsetHigh = (DWORD) (offset >> 32);
+  if (!ReadFile (p_file->h_pread, buf, (DWORD) size, &got, &ov))
+    return GetLastError () == ERROR_HANDLE_EOF ? 0 : -1;
+  return (ssize_t) got;
+#else
+  ssize_t ret;
+
+  if (p_file->fd_pread < 0)
+    return -1;
+
+  do {
+    ret = pread (p_file->fd_pread, buf, size, (off_t) offset);
+  } while (ret < 0 && errno == EINTR);
+  return ret;
+#endif
+}
+
+/*!
+  Returns a pointer to the raw frame of lsn in the memory-mapped .bin
+  file, and in *p_blocks the number of frames which follow it contiguously
+  (including itself). NULL is returned if the image is not memory-mapped
+  or lsn is out of range.
+ */
+static const uint8_t *
+_get_frames_bincue (const _img_private_t *p_env, lsn_t lsn,
+                    unsigned int *p_blocks)
+{
+  const _bincue_private_t *p_bincue = (const _bincue_private_t *) p_env;
+  const bincue_map_t *p_map;
+  size_t offset;
+  int i;
 
-  memcpy (data, buf + CDIO_CD_SYNC_SIZE + CDIO_CD_HEADER_SIZE,
-          b_form2 ? M2RAW_SECTOR_SIZE: CDIO_CD_FRAMESIZE);
+  if (p_bincue->access == BINCUE_ACCESS_STDIO)
+    return NULL;
+
+  i = _find_file_bincue (p_env, &lsn);
+  if (i < 0 || lsn < 0)
+    return NULL;
+
+  p_map = &p_bincue->files[i].map;
+  offset = (size_t) lsn * CDIO_CD_FRAMESIZE_RAW;
+  if (p_map->base == NULL || offset + CDIO_CD_FRAMESIZE_RAW > p_map->size)
+    return NULL;
+
+  *p_blocks = (unsigned int) ((p_map->size - offset) / CDIO_CD_FRAMESIZE_RAW);
+  return p_map->base + offset;
+}
+
+/*!
+   Returns a pointer to nblocks raw frames starting at lsn in the
+   memory-mapped image, or NULL if the image is not memory-mapped or the
+   frames are not contiguous in one .bin file.
+ */
+static const uint8_t *
+_get_raw_sectors_bincue (void *p_user_data, lsn_t lsn, unsigned int nblocks)
+{
+  unsigned int avail;
+  const uint8_t *frames = _get_frames_bincue (p_user_data, lsn, &avail);
+
+  return (frames != NULL && avail >= nblocks) ? frames : NULL;
+}
+
+/*!
+   Returns in *ppsz_filename the .bin file holding the frame of lsn, and in
+   *pi_offset the offset of the frame in that file.
+   Returns 0 if no error.
+ */
+static driver_return_code_t
+_get_raw_sector_file_bincue (void *p_user_data, lsn_t lsn,
+                             const char **ppsz_filename, uint64_t *pi_offset)
+{
+  const _bincue_private_t *p_bincue = p_user_data;
+  lsn_t file_lsn = lsn;
+  int i = _find_file_bincue (&p_bincue->img, &file_lsn);
+
+  if (i < 0 || file_lsn < 0 || p_bincue->files[i].psz_filename == NULL) {
+    cdio_warn ("LSN %d out of range in the available tracks", lsn);
+    return DRIVER_OP_ERROR;
+  }
 
+  *ppsz_filename = p_bincue->files[i].psz_filename;
+  *pi_offset = (uint64_t) file_lsn * CDIO_CD_FRAMESIZE_RAW;
   return DRIVER_OP_SUCCESS;
 }
 
 /*!
-   Reads nblocks of mode1 sectors from cd device into data starting
-   from lsn.
+   Reads nblocks raw frames starting at lsn into data. Unlike the other
+   read functions this does not use the stdio streams or any other state
+   which changes after the image was opened, so it may be called from
+   several threads at once.
    Returns 0 if no error.
  */
 static driver_return_code_t
-_read_mode1_sectors_bincue (void *p_user_data, void *data, lsn_t lsn,
-                            bool b_form2, unsigned int nblocks)
+_pread_raw_sectors_bincue (void *p_user_data, void *data, lsn_t lsn,
+                           unsigned int nblocks)
 {
-  _img_private_t *p_env = p_user_data;
-  int i;
-  int retval;
-  unsigned int blocksize = b_form2 ? M2RAW_SECTOR_SIZE : CDIO_CD_FRAMESIZE;
-
-  for (i = 0; i < nblocks; i++) {
-    if ( (retval = _read_mode1_sector_bincue (p_env,
-                                            ((char *)data) + (blocksize * i),
-                                            lsn + i, b_form2)) )
-      return retval;
+  const _bincue_private_t *p_bincue = p_user_data;
+  uint8_t *p = data;
+
+  while (nblocks > 0) {
+    lsn_t file_lsn = lsn;
+    unsigned int n = nblocks < BINCUE_MAX_READ_BLOCKS
+      ? nblocks : BINCUE_MAX_READ_BLOCKS;
+    unsigned int got;
+    const uint8_t *frames;
+    ssize_t ret;
+    int i;
+
+    frames = _get_frames_bincue (&p_bincue->img, lsn, &got);
+    if (frames != NULL) {
+      if (got > nblocks) got = nblocks;
+      memcpy (p, frames, (size_t) got * CDIO_CD_FRAMESIZE_RAW);
+    } else {
+      i = _find_file_bincue (&p_bincue->img, &file_lsn);
+      if (i < 0 || file_lsn < 0) {
+        cdio_warn ("LSN %d out of range in the available tracks", lsn);
+        return DRIVER_OP_ERROR;
+      }
+
+      /* A short read means the end of the .bin file was reached; the
+         remaining frames are fetched from the next one. */
+      ret = _pread_file_bincue (&p_bincue->files[i], p,
+                                (size_t) n * CDIO_CD_FRAMESIZE_RAW,
+                                (uint64_t) file_lsn * CDIO_CD_FRAMESIZE_RAW);
+      got = ret > 0 ? (unsigned int) (ret / CDIO_CD_FRAMESIZE_RAW) : 0;
+      if (got == 0)
+        return DRIVER_OP_ERROR;
+    }
+
+    p += (size_t) got * CDIO_CD_FRAMESIZE_RAW;
+    lsn += got;
+    nblocks -= got;
   }
+
   return DRIVER_OP_SUCCESS;
 }
 
 /*!
-   Reads a single mode1 sector from cd device into data starting
-   from lsn. Returns 0 if no error.
+   Reads up to nblocks raw frames starting at lsn into data through the
+   stdio streams, continuing in the next .bin file at the end of one.
+   Returns the number of frames read, which is less than nblocks at the
+   end of the image or on an error.
+ */
+static unsigned int
+_stream_read_frames_bincue (_img_private_t *p_env, uint8_t *data, lsn_t lsn,
+                            unsigned int nblocks)
+{
+  unsigned int total = 0;
+
+  while (total < nblocks) {
+    lsn_t file_lsn = lsn + total;
+    ssize_t ret;
+
+    if (!_switch_data_source_if_needed (p_env, &file_lsn))
+      break;
+
+    if (cdio_stream_seek (p_env->gen.data_source,
+                          (off_t) file_lsn * CDIO_CD_FRAMESIZE_RAW, SEEK_SET))
+      break;
+
+    ret = cdio_stream_read (p_env->gen.data_source,
+                            data + (size_t) total * CDIO_CD_FRAMESIZE_RAW,
+                            CDIO_CD_FRAMESIZE_RAW, nblocks - total);
+    if (ret < CDIO_CD_FRAMESIZE_RAW)
+      break;
+    total += (unsigned int) (ret / CDIO_CD_FRAMESIZE_RAW);
+  }
+
+  return total;
+}
+
+/*!
+   Releases all blocks of the sector cache.
+ */
+static void
+_cache_clear_bincue (bincue_cache_t *p_cache)
+{
+  unsigned int i;
+
+  for (i = 0; i < p_cache->i_blocks; i++)
+    free (p_cache->blocks[i].data);
+  free (p_cache->blocks);
+  p_cache->blocks = NULL;
+  p_cache->i_blocks = 0;
+}
+
+/*!
+   Returns a pointer to the raw frame of lsn in the sector cache, and in
+   *p_blocks the number of frames which follow it in the same cache block
+   (including itself). On a miss the block holding lsn is read through the
+   stdio streams, replacing the least recently used block if the cache is
+   full. NULL is returned if the cache is off or the frame cannot be read.
+ */
+static const uint8_t *
+_cache_get_frames_bincue (_bincue_private_t *p_bincue, lsn_t lsn,
+                          unsigned int *p_blocks)
+{
+  bincue_cache_t *p_cache = &p_bincue->cache;
+  bincue_cache_block_t *p_block = NULL;
+  lsn_t start;
+  unsigned int i;
+
+  if (p_cache->i_max_blocks == 0 || lsn < 0)
+    return NULL;
+
+  start = lsn - lsn % BINCUE_CACHE_BLOCK_FRAMES;
+  for (i = 0; i < p_cache->i_blocks; i++) {
+    if (p_cache->blocks[i].start == start) {
+      p_block = &p_cache->blocks[i];
+      break;
+    }
+  }
+
+  if (p_block != NULL && (unsigned int) (lsn - start) < p_block->i_frames) {
+    p_cache->hits++;
+  } else {
+    p_cache->misses++;
+
+    if (p_block == NULL) {
+      if (p_cache->blocks == NULL) {
+        p_cache->blocks = calloc (p_cache->i_max_blocks,
+                                  sizeof (bincue_cache_block_t));
+        if (p_cache->blocks == NULL)
+          return NULL;
+      }
+
+      if (p_cache->i_blocks < p_cache->i_max_blocks) {
+        p_block = &p_cache->blocks[p_cache->i_blocks];
+        p_block->data = malloc (BINCUE_CACHE_BLOCK_SIZE);
+        if (p_block->data == NULL)
+          return NULL;
+        p_cache->i_blocks++;
+      } else {
+        p_block = &p_cache->blocks[0];
+        for (i = 1; i < p_cache->i_blocks; i++)
+          if (p_cache->blocks[i].last_use < p_block->last_use)
+            p_block = &p_cache->blocks[i];
+      }
+    }
+
+    p_block->start = start;
+    p_block->i_frames =
+      _stream_read_frames_bincue (&p_bincue->img, p_block->data, start,
+                                  BINCUE_CACHE_BLOCK_FRAMES);
+    if ((unsigned int) (lsn - start) >= p_block->i_frames)
+      return NULL;  /* e.g. lsn is behind the end of the image */
+  }
+
+  p_block->last_use = ++p_cache->use_counter;
+  *p_blocks = p_block->i_frames - (unsigned int) (lsn - start);
+  return p_block->data + (size_t) (lsn - start) * CDIO_CD_FRAMESIZE_RAW;
+}
+
+/*!
+   Reads nblocks raw frames from the .bin file(s) starting at lsn, and
+   copies size bytes starting at offset of each frame into data. A
+   memory-mapped image is copied from directly, and reads of less than a
+   block are served from the sector cache. Otherwise there is one seek and
+   one read per BINCUE_MAX_READ_BLOCKS frames; whole frames are read
+   straight into data.
+   Returns 0 if no error.
  */
 static driver_return_code_t
-_read_mode2_sector_bincue (void *p_user_data, void *data, lsn_t lsn,
-                         bool b_form2)
+_read_frames_bincue (_img_private_t *p_env, void *data, lsn_t lsn,
+                     unsigned int nblocks, size_t offset, size_t size)
 {
-  _img_private_t *p_env = p_user_data;
-  int ret;
-  char buf[CDIO_CD_FRAMESIZE_RAW] = { 0, };
+  driver_return_code_t retval = DRIVER_OP_SUCCESS;
+  bool b_whole = (offset == 0 && size == CDIO_CD_FRAMESIZE_RAW);
+  bool b_cached = (nblocks < BINCUE_CACHE_BLOCK_FRAMES);
+  unsigned int max_blocks = nblocks < BINCUE_MAX_READ_BLOCKS
+    ? nblocks : BINCUE_MAX_READ_BLOCKS;
+  char *buf = NULL;
+  char *p = data;
 
-  /* NOTE: The logic below seems a bit wrong and convoluted
-     to me, but passes the regression tests. (Perhaps it is why we get
-     valgrind errors in vcdxrip). Leave it the way it was for now.
-     Review this sector 2336 stuff later.
-  */
+  while (nblocks > 0) {
+    lsn_t file_lsn = lsn;
+    unsigned int n = nblocks < max_blocks ? nblocks : max_blocks;
+    unsigned int got, i;
+    const uint8_t *frames;
+    ssize_t ret;
+
+    frames = _get_frames_bincue (p_env, lsn, &got);
+    if (frames == NULL && b_cached)
+      frames = _cache_get_frames_bincue ((_bincue_private_t *) p_env, lsn,
+                                         &got);
+    if (frames != NULL) {
+      if (got > nblocks) got = nblocks;
+      if (b_whole) {
+        memcpy (p, frames, (size_t) got * CDIO_CD_FRAMESIZE_RAW);
+      } else {
+        for (i = 0; i < got; i++)
+          memcpy (p + (size_t) i * size,
+                  frames + (size_t) i * CDIO_CD_FRAMESIZE_RAW + offset, size);
+      }
 
-  int blocksize = CDIO_CD_FRAMESIZE_RAW;
+      p += (size_t) got * size;
+      lsn += got;
+      nblocks -= got;
+      continue;
+    }
 
-  /* Ensure the data source is correctly set for the requested LSN */
-  if (!_switch_data_source_if_needed(p_env, &lsn)) {
-    cdio_warn("Failed to switch to the appropriate .bin file for LSN %d", lsn);
-    return false;
+    /* Ensure the data source is correctly set for the requested LSN */
+    if (!_switch_data_source_if_needed(p_env, &file_lsn)) {
+      cdio_warn("Failed to switch to the appropriate .bin file for LSN %d", lsn);
+      retval = DRIVER_OP_ERROR;
+      break;
+    }
+
+    if (cdio_stream_seek (p_env->gen.data_source,
+                          (off_t) file_lsn * CDIO_CD_FRAMESIZE_RAW, SEEK_SET)) {
+      retval = DRIVER_OP_ERROR;
+      break;
+    }
+
+    if (!b_whole && buf == NULL) {
+      buf = malloc ((size_t) max_blocks * CDIO_CD_FRAMESIZE_RAW);
+      if (!buf) {
+        retval = DRIVER_OP_ERROR;
+        break;
+      }
+    }
+
+    /* A short read means the end of the current .bin file was reached;
+       the remaining frames are fetched from the next one. */
+    ret = cdio_stream_read (p_env->gen.data_source, b_whole ? p : buf,
+                            CDIO_CD_FRAMESIZE_RAW, n);
+    got = ret > 0 ? (unsigned int) (ret / CDIO_CD_FRAMESIZE_RAW) : 0;
+    if (got == 0) {
+      retval = DRIVER_OP_ERROR;
+      break;
+    }
+
+    if (!b_whole) {
+      for (i = 0; i < got; i++)
+        memcpy (p + (size_t) i * size,
+                buf + (size_t) i * CDIO_CD_FRAMESIZE_RAW + offset, size);
+    }
+
+    p += (size_t) got * size;
+    lsn += got;
+    nblocks -= got;
   }
 
-  ret = cdio_stream_seek (p_env->gen.data_source, lsn * blocksize, SEEK_SET);
-  if (ret!=0) return ret;
+  free (buf);
+  return retval;
+}
 
-  ret = cdio_stream_read (p_env->gen.data_source, buf, CDIO_CD_FRAMESIZE_RAW, 1);
-  if (ret==0) return ret;
+/*!
+   Reads nblocks audio sectors from CD device into data starting
+   from lsn. Returns 0 if no error.
+ */
+static driver_return_code_t
+_read_audio_sectors_bincue (void *p_user_data, void *data, lsn_t lsn,
+                          unsigned int nblocks)
+{
+  return _read_frames_bincue (p_user_data, data, lsn, nblocks,
+                              0, CDIO_CD_FRAMESIZE_RAW);
+}
 
+/*!
+   Reads a single mode1 sector from cd device into data starting
+   from lsn. Returns 0 if no error.
+ */
+static driver_return_code_t
+_read_mode1_sector_bincue (void *p_user_data, void *data, lsn_t lsn,
+                           bool b_form2)
+{
+  return _read_frames_bincue (p_user_data, data, lsn, 1,
+                              CDIO_CD_SYNC_SIZE + CDIO_CD_HEADER_SIZE,
+                              b_form2 ? M2RAW_SECTOR_SIZE: CDIO_CD_FRAMESIZE);
+}
 
-  /* See NOTE above. */
+/*!
+   Reads nblocks of mode1 sectors from cd device into data starting
+   from lsn.
+   Returns 0 if no error.
+ */
+static driver_return_code_t
+_read_mode1_sectors_bincue (void *p_user_data, void *data, lsn_t lsn,
+                            bool b_form2, unsigned int nblocks)
+{
+  return _read_frames_bincue (p_user_data, data, lsn, nblocks,
+                              CDIO_CD_SYNC_SIZE + CDIO_CD_HEADER_SIZE,
+                              b_form2 ? M2RAW_SECTOR_SIZE: CDIO_CD_FRAMESIZE);
+}
+
+/*!
+   Reads a single mode2 sector from cd device into data starting
+   from lsn. Returns 0 if no error.
+ */
+static driver_return_code_t
+_read_mode2_sector_bincue (void *p_user_data, void *data, lsn_t lsn,
+                         bool b_form2)
+{
   if (b_form2)
-    memcpy (data, buf + CDIO_CD_SYNC_SIZE + CDIO_CD_HEADER_SIZE,
-            M2RAW_SECTOR_SIZE);
+    return _read_frames_bincue (p_user_data, data, lsn, 1,
+                                CDIO_CD_SYNC_SIZE + CDIO_CD_HEADER_SIZE,
+                                M2RAW_SECTOR_SIZE);
   else
-    memcpy (data, buf + CDIO_CD_XA_SYNC_HEADER, CDIO_CD_FRAMESIZE);
-
-  return DRIVER_OP_SUCCESS;
+    return _read_frames_bincue (p_user_data, data, lsn, 1,
+                                CDIO_CD_XA_SYNC_HEADER, CDIO_CD_FRAMESIZE);
 }
 
 /*!
@@ -1229,18 +1957,13 @@ static driver_return_code_t
 _read_mode2_sectors_bincue (void *p_user_data, void *data, lsn_t lsn,
                             bool b_form2, unsigned int nblocks)
 {
-  _img_private_t *p_env = p_user_data;
-  int i;
-  int retval;
-  unsigned int blocksize = b_form2 ? M2RAW_SECTOR_SIZE : CDIO_CD_FRAMESIZE;
-
-  for (i = 0; i < nblocks; i++) {
-    if ( (retval = _read_mode2_sector_bincue (p_env,
-                                            ((char *)data) + (blocksize * i),
-                                            lsn + i, b_form2)) )
-      return retval;
-  }
-  return 0;
+  if (b_form2)
+    return _read_frames_bincue (p_user_data, data, lsn, nblocks,
+                                CDIO_CD_SYNC_SIZE + CDIO_CD_HEADER_SIZE,
+                                M2RAW_SECTOR_SIZE);
+  else
+    return _read_frames_bincue (p_user_data, data, lsn, nblocks,
+                                CDIO_CD_XA_SYNC_HEADER, CDIO_CD_FRAMESIZE);
 }
 
 #if !defined(HAVE_GLOB_H) && defined(_WIN32)
@@ -1501,18 +2224,142 @@ cdio_is_binfile(const char *psz_bin_name)
   return NULL;
 }
 
+/*!
+  Releases the memory mappings and cached streams of the image before the
+  common image data. The current stream is closed with the latter.
+ */
+static void
+_free_bincue (void *p_user_data)
+{
+  _bincue_private_t *p_bincue = p_user_data;
+  int i;
+
+  if (NULL == p_bincue) return;
+
+  for (i = 0; i < p_bincue->i_files; i++) {
+    bincue_file_t *p_file = &p_bincue->files[i];
+    _unmap_file_bincue (&p_file->map);
+    _close_pread_bincue (p_file);
+    if (p_file->source && p_file->source != p_bincue->img.gen.data_source)
+      cdio_stdio_destroy (p_file->source);
+    p_file->source = NULL;
+  }
+
+  _cache_clear_bincue (&p_bincue->cache);
+  _free_image (p_user_data);
+}
+
+/*!
+  Returns the value of the argument key. Besides the arguments of all
+  image drivers, these are available:
+
+  "cache-size": memory cap of the sector cache in bytes
+  "cache-hits", "cache-misses": number of reads served from the sector
+  cache, and of blocks read into it
+ */
+static const char *
+_get_arg_bincue (void *p_user_data, const char key[])
+{
+  _bincue_private_t *p_bincue = p_user_data;
+  bincue_cache_t *p_cache = &p_bincue->cache;
+  unsigned long long value;
+  int i;
+
+  if (!strcmp (key, "cache-size")) {
+    value = (unsigned long long) p_cache->i_max_blocks * BINCUE_CACHE_BLOCK_SIZE;
+    i = 0;
+  } else if (!strcmp (key, "cache-hits")) {
+    value = p_cache->hits;
+    i = 1;
+  } else if (!strcmp (key, "cache-misses")) {
+    value = p_cache->misses;
+    i = 2;
+  } else
+    return _get_arg_image (p_user_data, key);
+
+  snprintf (p_cache->arg_buf[i], sizeof (p_cache->arg_buf[i]), "%llu", value);
+  return p_cache->arg_buf[i];
+}
+
+/*!
+  Sets the argument key to value. Besides the arguments of all image
+  drivers, "cache-size" sets the memory cap of the sector cache in bytes,
+  rounded down to whole blocks of BINCUE_CACHE_BLOCK_FRAMES frames. "0"
+  turns the cache off. Changing the size empties the cache.
+ */
+static int
+_set_arg_bincue (void *p_user_data, const char key[], const char value[])
+{
+  _bincue_private_t *p_bincue = p_user_data;
+  bincue_cache_t *p_cache = &p_bincue->cache;
+  unsigned long long size;
+  char *end;
+
+  if (strcmp (key, "cache-size"))
+    return _set_arg_image (p_user_data, key, value);
+
+  if (value == NULL)
+    return DRIVER_OP_BAD_PARAMETER;
+  size = strtoull (value, &end, 10);
+  if (end == value || *end != '\0')
+    return DRIVER_OP_BAD_PARAMETER;
+
+  _cache_clear_bincue (p_cache);
+  size /= BINCUE_CACHE_BLOCK_SIZE;
+  p_cache->i_max_blocks = size > UINT_MAX ? UINT_MAX : (unsigned int) size;
+  return DRIVER_OP_SUCCESS;
+}
+
+static CdIo_t *
+_open_cue_bincue (const char *psz_cue_name, bincue_access_t access);
+
+/*!
+  Opens a .bin or .cue file with the given access method.
+ */
+static CdIo_t *
+_open_bincue (const char *psz_source, bincue_access_t access)
+{
+  char *psz_bin_name = cdio_is_cuefile(psz_source);
+
+  if (NULL != psz_bin_name) {
+    free(psz_bin_name);
+    return _open_cue_bincue(psz_source, access);
+  } else {
+    char *psz_cue_name = cdio_is_binfile(psz_source);
+    CdIo_t *cdio = _open_cue_bincue(psz_cue_name, access);
+    free(psz_cue_name);
+    return cdio;
+  }
+}
+
 /*!
   Initialization routine. This is the only thing that doesn't
   get called via a function pointer. In fact *we* are the
   ones to set that up.
+
+  psz_access_mode selects how the .bin files are read: "bincue" (or NULL)
+  reads through stdio streams. "mmap" maps the files into memory, which
+  also makes cdio_get_raw_sectors() available. "mmap-sequential" and
+  "mmap-random" additionally tell the OS whether the image will be read
+  front to back or with scattered lookups.
  */
 CdIo_t *
 cdio_open_am_bincue (const char *psz_source_name, const char *psz_access_mode)
 {
-  if (psz_access_mode != NULL)
-    cdio_warn ("there is only one access mode for bincue. Arg %s ignored",
-               psz_access_mode);
-  return cdio_open_bincue(psz_source_name);
+  bincue_access_t access = BINCUE_ACCESS_STDIO;
+
+  if (psz_access_mode == NULL || !strcmp(psz_access_mode, "bincue"))
+    access = BINCUE_ACCESS_STDIO;
+  else if (!strcmp(psz_access_mode, "mmap"))
+    access = BINCUE_ACCESS_MMAP;
+  else if (!strcmp(psz_access_mode, "mmap-sequential"))
+    access = BINCUE_ACCESS_MMAP_SEQUENTIAL;
+  else if (!strcmp(psz_access_mode, "mmap-random"))
+    access = BINCUE_ACCESS_MMAP_RANDOM;
+  else
+    cdio_warn ("unknown access mode %s for bincue ignored", psz_access_mode);
+
+  return _open_bincue(psz_source_name, access);
 }
 
 /*!
@@ -1523,23 +2370,23 @@ cdio_open_am_bincue (const char *psz_source_name, const char *psz_access_mode)
 CdIo_t *
 cdio_open_bincue (const char *psz_source)
 {
-  char *psz_bin_name = cdio_is_cuefile(psz_source);
-
-  if (NULL != psz_bin_name) {
-    free(psz_bin_name);
-    return cdio_open_cue(psz_source);
-  } else {
-    char *psz_cue_name = cdio_is_binfile(psz_source);
-    CdIo_t *cdio = cdio_open_cue(psz_cue_name);
-    free(psz_cue_name);
-    return cdio;
-  }
+  return _open_bincue(psz_source, BINCUE_ACCESS_STDIO);
 }
 
 CdIo_t *
 cdio_open_cue (const char *psz_cue_name)
 {
+  return _open_cue_bincue(psz_cue_name, BINCUE_ACCESS_STDIO);
+}
+
+static CdIo_t *
+_open_cue_bincue (const char *psz_cue_name, bincue_access_t access)
+{
+  static const char *access_names[] = {
+    "bincue", "mmap", "mmap-sequential", "mmap-random"
+  };
   CdIo_t *ret;
+  _bincue_private_t *p_bincue;
   _img_private_t *p_data;
   char *psz_bin_name;
 
@@ -1548,8 +2395,8 @@ cdio_open_cue (const char *psz_cue_name)
   memset( &_funcs, 0, sizeof(_funcs) );
 
   _funcs.eject_media           = _eject_media_image;
-  _funcs.free                  = _free_image;
-  _funcs.get_arg               = _get_arg_image;
+  _funcs.free                  = _free_bincue;
+  _funcs.get_arg               = _get_arg_bincue;
   _funcs.get_cdtext            = _get_cdtext_image;
   _funcs.get_cdtext_raw        = NULL;
   _funcs.get_devices           = cdio_get_devices_bincue;
@@ -1562,6 +2409,8 @@ cdio_open_cue (const char *psz_cue_name)
   _funcs.get_media_changed     = get_media_changed_image;
   _funcs.get_mcn               = _get_mcn_image;
   _funcs.get_num_tracks        = _get_num_tracks_image;
+  _funcs.get_raw_sectors       = _get_raw_sectors_bincue;
+  _funcs.get_raw_sector_file   = _get_raw_sector_file_bincue;
   _funcs.get_track_channels    = get_track_channels_image;
   _funcs.get_track_copy_permit = get_track_copy_permit_image;
   _funcs.get_track_format      = _get_track_format_bincue;
@@ -1574,6 +2423,7 @@ cdio_open_cue (const char *psz_cue_name)
   _funcs.get_track_pregap_lba  = get_track_pregap_lba_image;
   _funcs.get_track_isrc        = get_track_isrc_image;
   _funcs.lseek                 = _lseek_bincue;
+  _funcs.pread_raw_sectors     = _pread_raw_sectors_bincue;
   _funcs.read                  = _read_bincue;
   _funcs.read_audio_sectors    = _read_audio_sectors_bincue;
   _funcs.read_data_sectors     = read_data_sectors_image;
@@ -1582,20 +2432,24 @@ cdio_open_cue (const char *psz_cue_name)
   _funcs.read_mode2_sector     = _read_mode2_sector_bincue;
   _funcs.read_mode2_sectors    = _read_mode2_sectors_bincue;
   _funcs.run_mmc_cmd           =  NULL;
-  _funcs.set_arg               = _set_arg_image;
+  _funcs.set_arg               = _set_arg_bincue;
   _funcs.set_speed             = cdio_generic_unimplemented_set_speed;
   _funcs.set_blocksize         = cdio_generic_unimplemented_set_blocksize;
 
   if (NULL == psz_cue_name) return NULL;
 
-  p_data                 = calloc(1, sizeof (_img_private_t));
+  p_bincue               = calloc(1, sizeof (_bincue_private_t));
+  p_bincue->access       = access;
+  p_bincue->cache.i_max_blocks =
+    BINCUE_CACHE_DEFAULT_SIZE / BINCUE_CACHE_BLOCK_SIZE;
+  p_data                 = &p_bincue->img;
   p_data->gen.init       = false;
   p_data->psz_cue_name   = NULL;
 
   ret = cdio_new ((void *)p_data, &_funcs);
 
   if (ret == NULL) {
-    free(p_data);
+    free(p_bincue);
     return NULL;
   }
 
@@ -1609,13 +2463,17 @@ cdio_open_cue (const char *psz_cue_name)
 
   _set_arg_image (p_data, "cue", psz_cue_name);
   _set_arg_image (p_data, "source", psz_bin_name); // Bin naming problem! Didn't use parsed filename from .cue file!
-  _set_arg_image (p_data, "access-mode", "bincue");
+  _set_arg_image (p_data, "access-mode", access_names[access]);
   free(psz_bin_name);
 
   if (_init_bincue(p_data)) {
+    _map_image_bincue(p_bincue);
+    _open_pread_bincue(p_bincue);
+    if (p_bincue->access != access)
+      _set_arg_image (p_data, "access-mode", access_names[p_bincue->access]);
     return ret;
   } else {
-    _free_image(p_data);
+    _free_bincue(p_data);
     free(ret);
     return NULL;
   }
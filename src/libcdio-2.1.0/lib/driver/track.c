@@ -464,3 +464,60 @@ cdio_get_track_end_sector(const CdIo_t *p_cdio, track_t u_track)
     }
     return end_lba;
 }
+
+/*!
+  Return a pointer to i_blocks consecutive raw frames starting at i_lsn
+  without copying them, or NULL if the driver cannot provide that.
+*/
+const uint8_t *
+cdio_get_raw_sectors(const CdIo_t *p_cdio, lsn_t i_lsn, uint32_t i_blocks)
+{
+    if (p_cdio == NULL || p_cdio->op.get_raw_sectors == NULL) {
+        return NULL;
+    }
+    return p_cdio->op.get_raw_sectors(p_cdio->env, i_lsn, i_blocks);
+}
+
+/*!
+  Return the file holding the raw frame at i_lsn and the byte offset of
+  the frame in it.
+*/
+driver_return_code_t
+cdio_get_raw_sector_file(const CdIo_t *p_cdio, lsn_t i_lsn,
+                         const char **ppsz_filename, uint64_t *pi_offset)
+{
+    if (p_cdio == NULL) {
+        return DRIVER_OP_UNINIT;
+    }
+    if (p_cdio->op.get_raw_sector_file == NULL) {
+        return DRIVER_OP_UNSUPPORTED;
+    }
+    if (ppsz_filename == NULL || pi_offset == NULL) {
+        return DRIVER_OP_BAD_POINTER;
+    }
+    return p_cdio->op.get_raw_sector_file(p_cdio->env, i_lsn,
+                                          ppsz_filename, pi_offset);
+}
+
+/*!
+  Read i_blocks raw frames starting at i_lsn into p_buf without a
+  shared file position. This may be called from several threads at once.
+*/
+driver_return_code_t
+cdio_pread_raw_sectors(const CdIo_t *p_cdio, void *p_buf, lsn_t i_lsn,
+                       uint32_t i_blocks)
+{
+    if (p_cdio == NULL) {
+        return DRIVER_OP_UNINIT;
+    }
+    if (p_cdio->op.pread_raw_sectors == NULL) {
+        return DRIVER_OP_UNSUPPORTED;
+    }
+    if (i_blocks == 0) {
+        return DRIVER_OP_SUCCESS;
+    }
+    if (p_buf == NULL) {
+        return DRIVER_OP_BAD_POINTER;
+    }
+    return p_cdio->op.pread_raw_sectors(p_cdio->env, p_buf, i_lsn, i_blocks);
+}
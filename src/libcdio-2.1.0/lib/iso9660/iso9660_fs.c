@@ -775,10 +775,121 @@ iso9660_check_dir_block_end(iso9660_dir_t *p_iso9660_dir, unsigned *offset)
 }
 
 
+/* Size of the blocks an iso9660_stat_arena_t allocates from. */
+#define STAT_ARENA_BLOCK_SIZE (64 * 1024)
+
+/* Alignment of the allocations from an iso9660_stat_arena_t. */
+#define STAT_ARENA_ALIGN 16
+
+#define STAT_ARENA_ROUND(n) \
+  (((n) + STAT_ARENA_ALIGN - 1) & ~((size_t) STAT_ARENA_ALIGN - 1))
+
+typedef struct _stat_arena_block_s {
+  struct _stat_arena_block_s *p_next;
+  size_t i_size;            /**< usable bytes after the header */
+  size_t i_used;            /**< bytes handed out so far */
+} _stat_arena_block_t;
+
+#define STAT_ARENA_HEADER STAT_ARENA_ROUND(sizeof(_stat_arena_block_t))
+
+/** Implementation of iso9660_stat_arena_t type */
+struct iso9660_stat_arena_s {
+  _stat_arena_block_t *p_head; /**< block currently allocated from */
+  void *p_last;                /**< most recent allocation */
+  size_t i_last_used;          /**< i_used of p_head before p_last */
+};
+
+/*!
+  Create an empty arena for iso9660_stat_t records. NULL is returned
+  if memory allocation fails.
+*/
+iso9660_stat_arena_t *
+iso9660_stat_arena_new (void)
+{
+  return calloc(1, sizeof(iso9660_stat_arena_t));
+}
+
+/*!
+  Free an arena together with all records allocated from it.
+*/
+void
+iso9660_stat_arena_free (iso9660_stat_arena_t *p_arena)
+{
+  _stat_arena_block_t *p_block;
+
+  if (!p_arena) return;
+
+  p_block = p_arena->p_head;
+  while (p_block) {
+    _stat_arena_block_t *p_next = p_block->p_next;
+    free(p_block);
+    p_block = p_next;
+  }
+  free(p_arena);
+}
+
+/* Return i_size zeroed bytes from p_arena, or from the heap if p_arena
+   is NULL. */
+static void *
+_stat_alloc (iso9660_stat_arena_t *p_arena, size_t i_size)
+{
+  _stat_arena_block_t *p_block;
+  void *p;
+
+  if (!p_arena) return calloc(1, i_size);
+
+  i_size = STAT_ARENA_ROUND(i_size);
+  p_block = p_arena->p_head;
+
+  if (!p_block || p_block->i_size - p_block->i_used < i_size) {
+    size_t i_block_size = i_size > STAT_ARENA_BLOCK_SIZE
+      ? i_size : STAT_ARENA_BLOCK_SIZE;
+    p_block = malloc(STAT_ARENA_HEADER + i_block_size);
+    if (!p_block) return NULL;
+    p_block->p_next = p_arena->p_head;
+    p_block->i_size = i_block_size;
+    p_block->i_used = 0;
+    p_arena->p_head = p_block;
+  }
+
+  p = (uint8_t *) p_block + STAT_ARENA_HEADER + p_block->i_used;
+  p_arena->p_last = p;
+  p_arena->i_last_used = p_block->i_used;
+  p_block->i_used += i_size;
+
+  memset(p, 0, i_size);
+  return p;
+}
+
+/* Release memory returned by _stat_alloc(). Arena memory is only
+   reclaimed if it was the most recent allocation. */
+static void
+_stat_release (iso9660_stat_arena_t *p_arena, void *p)
+{
+  if (!p_arena) {
+    free(p);
+  } else if (p && p == p_arena->p_last) {
+    p_arena->p_head->i_used = p_arena->i_last_used;
+    p_arena->p_last = NULL;
+  }
+}
+
+/* Free a record returned by _iso9660_dir_to_statbuf_arena(). */
+static void
+_stat_free (iso9660_stat_arena_t *p_arena, iso9660_stat_t *p_stat)
+{
+  if (!p_arena) {
+    iso9660_stat_free(p_stat);
+  } else {
+    _stat_release(p_arena, p_stat->rr.psz_symlink);
+    _stat_release(p_arena, p_stat);
+  }
+}
 
 static iso9660_stat_t *
-_iso9660_dir_to_statbuf (iso9660_dir_t *p_iso9660_dir, bool_3way_t b_xa,
-			 uint8_t u_joliet_level)
+_iso9660_dir_to_statbuf_arena (iso9660_dir_t *p_iso9660_dir,
+			       bool_3way_t b_xa, uint8_t u_joliet_level,
+			       iso9660_stat_arena_t *p_arena)
 {
   uint8_t dir_len= iso9660_get_dir_len(p_iso9660_dir);
   iso711_t i_fname;
@@ -792,7 +903,7 @@ _iso9660_dir_to_statbuf (iso9660_dir_t *p_iso9660_dir, bool_3way_t b_xa,
   /* .. string in statbuf is one longer than in p_iso9660_dir's listing '\1' */
   stat_len      = sizeof(iso9660_stat_t)+i_fname+2;
 
-  p_stat          = calloc(1, stat_len);
+  p_stat          = _stat_alloc(p_arena, stat_len);
   if (!p_stat)
     {
     cdio_warn("Couldn't calloc(1, %d)", stat_len);
@@ -824,15 +935,15 @@ _iso9660_dir_to_statbuf (iso9660_dir_t *p_iso9660_dir, bool_3way_t b_xa,
       if (i_rr_fname > i_fname) {
 	/* realloc gives valgrind errors */
 	iso9660_stat_t *p_stat_new =
-	  calloc(1, sizeof(iso9660_stat_t)+i_rr_fname+2);
+	  _stat_alloc(p_arena, sizeof(iso9660_stat_t)+i_rr_fname+2);
         if (!p_stat_new)
           {
           cdio_warn("Couldn't calloc(1, %d)", (int)(sizeof(iso9660_stat_t)+i_rr_fname+2));
-	  free(p_stat);
+	  _stat_free(p_arena, p_stat);
           return NULL;
           }
 	memcpy(p_stat_new, p_stat, stat_len);
-	free(p_stat);
+	_stat_release(p_arena, p_stat);
 	p_stat = p_stat_new;
       }
       strncpy(p_stat->filename, rr_fname, i_rr_fname+1);
@@ -851,7 +962,7 @@ _iso9660_dir_to_statbuf (iso9660_dir_t *p_iso9660_dir, bool_3way_t b_xa,
           free(p_psz_out);
         }
         else {
-          free(p_stat);
+          _stat_release(p_arena, p_stat);
           return NULL;
         }
       }
@@ -863,10 +974,22 @@ _iso9660_dir_to_statbuf (iso9660_dir_t *p_iso9660_dir, bool_3way_t b_xa,
   }
 
 
+  /* The Rock Ridge parser allocates symlink targets from the heap */
+  if (p_arena && p_stat->rr.psz_symlink) {
+    char *psz_symlink = _stat_alloc(p_arena, p_stat->rr.i_symlink_max);
+    if (psz_symlink)
+      memcpy(psz_symlink, p_stat->rr.psz_symlink, p_stat->rr.i_symlink_max);
+    free(p_stat->rr.psz_symlink);
+    p_stat->rr.psz_symlink = psz_symlink;
+    if (!psz_symlink) {
+      p_stat->rr.i_symlink = p_stat->rr.i_symlink_max = 0;
+    }
+  }
+
   iso9660_get_dtime(&(p_iso9660_dir->recording_time), true, &(p_stat->tm));
 
   if (dir_len < sizeof (iso9660_dir_t)) {
-    iso9660_stat_free(p_stat);
+    _stat_free(p_arena, p_stat);
     return NULL;
   }
 
@@ -913,6 +1036,14 @@ _iso9660_dir_to_statbuf (iso9660_dir_t *p_iso9660_dir, bool_3way_t b_xa,
 
 }
 
+static iso9660_stat_t *
+_iso9660_dir_to_statbuf (iso9660_dir_t *p_iso9660_dir, bool_3way_t b_xa,
+			 uint8_t u_joliet_level)
+{
+  return _iso9660_dir_to_statbuf_arena(p_iso9660_dir, b_xa, u_joliet_level,
+				       NULL);
+}
+
 /*!
   Return the directory name stored in the iso9660_dir_t
 
@@ -1417,6 +1548,48 @@ iso9660_fs_readdir (CdIo_t *p_cdio, const char psz_path[])
   }
 }
 
+/*!
+  Convert a directory record read from p_cdio into an iso9660_stat_t.
+  NULL is returned on error. The caller must free the returned result
+  using iso9660_stat_free().
+*/
+iso9660_stat_t *
+iso9660_fs_dir_to_stat (const CdIo_t *p_cdio,
+			const iso9660_dir_t *p_iso9660_dir)
+{
+  generic_img_private_t *p_env;
+
+  if (!p_cdio)        return NULL;
+  if (!p_iso9660_dir) return NULL;
+
+  p_env = (generic_img_private_t *) p_cdio->env;
+
+  return _iso9660_dir_to_statbuf((iso9660_dir_t *) p_iso9660_dir, dunno,
+				 p_env->u_joliet_level);
+}
+
+/*!
+  Like iso9660_fs_dir_to_stat(), but allocate the result from p_arena.
+  NULL is returned on error. The result must not be passed to
+  iso9660_stat_free(); it is released with the arena.
+*/
+iso9660_stat_t *
+iso9660_fs_dir_to_stat_arena (const CdIo_t *p_cdio,
+			      const iso9660_dir_t *p_iso9660_dir,
+			      iso9660_stat_arena_t *p_arena)
+{
+  generic_img_private_t *p_env;
+
+  if (!p_cdio)        return NULL;
+  if (!p_iso9660_dir) return NULL;
+  if (!p_arena)       return NULL;
+
+  p_env = (generic_img_private_t *) p_cdio->env;
+
+  return _iso9660_dir_to_statbuf_arena((iso9660_dir_t *) p_iso9660_dir,
+				       dunno, p_env->u_joliet_level, p_arena);
+}
+
 /*!
   Read psz_path (a directory) and return a list of iso9660_stat_t
   of the files inside that. The caller must free the returned result.
@@ -0,0 +1,101 @@
+//
+// PSXImager - Read-only memory mapped input files
+//
+// Copyright (C) Christian Bauer <www.cebix.net>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+//
+
+#include "mappedfile.h"
+
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <stdexcept>
+namespace fs = std::filesystem;
+using namespace std;
+
+// POSIX systems map the file with mmap(). Elsewhere the data is read
+// through an ifstream.
+#if defined(__unix__) || defined(__APPLE__)
+	#define HAVE_MMAP 1
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+
+// Map or read the file.
+MappedFile::MappedFile(const fs::path & path)
+{
+#ifdef HAVE_MMAP
+	int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		throw runtime_error(format("Cannot open file {}: {}", path.string(), strerror(errno)));
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+		fileSize = uint64_t(st.st_size);
+		if (fileSize == 0) {
+			close(fd);
+			return;
+		}
+
+		void * p = mmap(nullptr, size_t(fileSize), PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p != MAP_FAILED) {
+			// The file is read once from start to end
+			posix_madvise(p, size_t(fileSize), POSIX_MADV_SEQUENTIAL);
+
+			contents = static_cast<const char *>(p);
+			mapped = true;
+			close(fd);
+			return;
+		}
+	}
+	close(fd);
+#endif
+
+	// Read the whole file instead
+	ifstream f(path, ifstream::in | ifstream::binary);
+	if (!f) {
+		throw runtime_error(format("Cannot open file {}", path.string()));
+	}
+
+	fileSize = fs::file_size(path);
+	if (fileSize == 0) {
+		return;
+	}
+
+	buffer.reset(new char[size_t(fileSize)]);
+	f.read(buffer.get(), streamsize(fileSize));
+	if (uint64_t(f.gcount()) != fileSize) {
+		throw runtime_error(format("Error reading file {}", path.string()));
+	}
+	contents = buffer.get();
+}
+
+
+// Unmap the file.
+MappedFile::~MappedFile()
+{
+#ifdef HAVE_MMAP
+	if (mapped) {
+		munmap(const_cast<char *>(contents), size_t(fileSize));
+	}
+#endif
+}
@@ -0,0 +1,58 @@
+//
+// PSXImager - Read-only memory mapped input files
+//
+// Copyright (C) Christian Bauer <www.cebix.net>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+//
+
+#ifndef PSXIMAGER_MAPPEDFILE_H
+#define PSXIMAGER_MAPPEDFILE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+
+// Input file whose contents are accessible in memory. On POSIX systems the
+// file is mapped read-only with mmap(), elsewhere (or if mapping fails) it
+// is read into a buffer. Throws a runtime_error if the file cannot be
+// opened or read.
+class MappedFile {
+public:
+	explicit MappedFile(const std::filesystem::path & path);
+	~MappedFile();
+
+	MappedFile(const MappedFile &) = delete;
+	MappedFile & operator=(const MappedFile &) = delete;
+
+	// File contents (NULL for an empty file)
+	const char * data() const { return contents; }
+
+	// File size in bytes
+	uint64_t size() const { return fileSize; }
+
+private:
+	const char * contents = nullptr;
+	uint64_t fileSize = 0;
+
+	// True if 'contents' is a mapping which must be unmapped
+	bool mapped = false;
+
+	// Buffer holding the contents if the file is not mapped
+	std::unique_ptr<char[]> buffer;
+};
+
+#endif
@@ -0,0 +1,82 @@
+//
+// PSXImager - Running independent jobs on a pool of threads
+//
+// Copyright (C) Christian Bauer <www.cebix.net>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+//
+
+#ifndef PSXIMAGER_PARALLEL_H
+#define PSXIMAGER_PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// Call 'func(i)' for every i in [0, count) on up to 'numThreads' threads,
+// which take the indices in ascending order. With a single thread the
+// calls are made in the calling thread. The first exception thrown by
+// 'func' stops the remaining calls and is rethrown when all threads have
+// finished.
+template <typename Func>
+void parallelFor(size_t count, size_t numThreads, Func func)
+{
+	numThreads = std::min(numThreads, count);
+
+	if (numThreads <= 1) {
+		for (size_t i = 0; i < count; ++i) {
+			func(i);
+		}
+		return;
+	}
+
+	std::atomic<size_t> next = 0;
+	std::atomic<bool> failed = false;
+	std::exception_ptr error;
+	std::mutex errorMutex;
+
+	std::vector<std::thread> threads;
+	for (size_t t = 0; t < numThreads; ++t) {
+		threads.emplace_back([&] {
+			try {
+				size_t i;
+				while (!failed && (i = next++) < count) {
+					func(i);
+				}
+			} catch (...) {
+				std::lock_guard<std::mutex> lock(errorMutex);
+				if (!error) {
+					error = std::current_exception();
+				}
+				failed = true;
+			}
+		});
+	}
+
+	for (auto & t : threads) {
+		t.join();
+	}
+
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
+
+#endif
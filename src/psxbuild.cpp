@@ -26,11 +26,21 @@ extern "C" {
 #include <libvcd/sector.h>
 }
 
+#include "cdsector.h"
+#include "edc.h"
+#include "filecopy.h"
+#include "hash.h"
+#include "imagewriter.h"
+#include "mappedfile.h"
+#include "parallel.h"
+
 #include <algorithm>
+#include <condition_variable>
 #include <cstring>
 #include <cctype>
 #include <charconv>
 #include <cstdint>
+#include <deque>
 #include <exception>
 #include <filesystem>
 #include <format>
@@ -38,12 +48,16 @@ extern "C" {
 #include <iostream>
 #include <memory>
 #include <iterator>
+#include <map>
+#include <mutex>
 #include <queue>
 #include <ranges>
 #include <regex>
+#include <set>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <time.h>
 #include <vector>
 namespace fs = std::filesystem;
@@ -75,6 +89,9 @@ int track1PostgapType = 0;
 int timeZone = 0;
 int y2kbug = 0;
 
+// Number of threads used for encoding sectors (1 = encode on the main thread)
+unsigned numJobs = 1;
+
 std::string track_listing = "";
 std::vector<TrackInfo> tracks;
 
@@ -87,6 +104,54 @@ static char buffer[CDIO_CD_FRAMESIZE_RAW];
 static const uint8_t emptySector[M2F2_SECTOR_SIZE] = {0};
 static const uint8_t emptySectorRAW[CDIO_CD_FRAMESIZE_RAW] = {0};
 
+
+// Hashes of every track and of the whole image, fed with the frames as they
+// are written to the image file, so the image doesn't have to be read back
+// to check it. This requires the image to be written in order.
+class ImageHashes {
+public:
+	bool enabled = false;
+
+	// Start hashing the next track
+	void startTrack(int number)
+	{
+		if (enabled) {
+			tracks.emplace_back(number, RedumpHash());
+		}
+	}
+
+	// Add the data written at 'offset' of the image
+	void update(uint64_t offset, const void * data, size_t size)
+	{
+		if (enabled) {
+			if (offset != hashedSize) {
+				throw logic_error("Image not written in order, cannot hash it");
+			}
+			tracks.back().second.update(data, size);
+			image.update(data, size);
+			hashedSize += size;
+		}
+	}
+
+	vector<pair<int, RedumpHash>> tracks;
+	RedumpHash image;
+
+private:
+	uint64_t hashedSize = 0;
+};
+
+static ImageHashes imageHashes;
+
+
+// Write raw frames to their place in the image file, starting at sector
+// 'lsn', and add them to the image hashes.
+static void writeFrames(ImageWriter & image, uint32_t lsn, const char * frames, size_t count)
+{
+	uint64_t offset = uint64_t(lsn) * CDIO_CD_FRAMESIZE_RAW;
+	image.writeAt(offset, frames, count * CDIO_CD_FRAMESIZE_RAW);
+	imageHashes.update(offset, frames, count * CDIO_CD_FRAMESIZE_RAW);
+}
+
 // Maximum number of sectors in an image
 const uint32_t MAX_ISO_SECTORS = 74 * 60 * 75;  // 74 minutes
 
@@ -200,55 +265,74 @@ void generateCueFile(const std::vector<TrackInfo>& tracks, const fs::path& image
 	std::cout << "Cue file written to " << imageCueName << "..." << std::endl;
 }
 
-void writeAudioTracks(std::vector<TrackInfo>& tracks, const std::filesystem::path& inputPath, std::ofstream& image) {
-	for (const auto& track : tracks) {
-		if (track.trackType == "AUDIO") {
-			// Generate the WAV filename using the track information
-			// Process pregap if file exists
-			std::string wavFileName = std::format("Pregap_{:02}.wav", track.trackNumber);
-			std::filesystem::path fullPathWav = psxripDir / wavFileName;
-			std::ifstream wavFile;
-			char chunkHeader[4];
-			uint32_t chunkSize;
-			bool dataChunkFound = false;
-			std::vector<char> buffer(4096);
+// Locate the PCM data of a WAV file, which runs from the start of the
+// "data" chunk to the end of the file.
+static void findWavData(const fs::path & wavPath, uint64_t & dataOffset, uint64_t & dataSize) {
+	std::ifstream wavFile(wavPath, std::ios::binary);
+	if (!wavFile) {
+		throw std::runtime_error("Error opening WAV file: " + wavPath.string());
+	}
 
-			if (fs::exists(fullPathWav)) {
-				// Stream the audio data from the WAV file instead of loading it all into memory
-				wavFile.open(fullPathWav, std::ios::binary);
-				if (!wavFile) {
-					throw std::runtime_error("Error opening WAV file: " + fullPathWav.string());
-				}
+	// Locate the "data" chunk after the RIFF header
+	char chunkHeader[4];
+	uint32_t chunkSize;
+	bool dataChunkFound = false;
 
-				// Locate the "data" chunk after the RIFF header
-				wavFile.seekg(12);  // Skip RIFF, Chunk Size, and WAVE headers (4 + 4 + 4 bytes)
+	wavFile.seekg(12);  // Skip RIFF, Chunk Size, and WAVE headers (4 + 4 + 4 bytes)
 
-				while (wavFile.read(chunkHeader, 4)) {
-					wavFile.read(reinterpret_cast<char*>(&chunkSize), sizeof(chunkSize));
+	while (wavFile.read(chunkHeader, 4)) {
+		wavFile.read(reinterpret_cast<char*>(&chunkSize), sizeof(chunkSize));
 
-					if (std::strncmp(chunkHeader, "data", 4) == 0) {
-						dataChunkFound = true;
-						break;
-					}
+		if (std::strncmp(chunkHeader, "data", 4) == 0) {
+			dataChunkFound = true;
+			break;
+		}
 
-					wavFile.seekg(chunkSize, std::ios::cur);
-				}
+		wavFile.seekg(chunkSize, std::ios::cur);
+	}
 
-				if (!dataChunkFound) {
-					throw std::runtime_error("Invalid WAV file (missing 'data' chunk): " + fullPathWav.string());
-				}
+	if (!dataChunkFound) {
+		throw std::runtime_error("Invalid WAV file (missing 'data' chunk): " + wavPath.string());
+	}
 
-				// Stream audio data in chunks to avoid high memory usage
-				while (wavFile.read(buffer.data(), buffer.size()) || wavFile.gcount() > 0) {
-					image.write(buffer.data(), wavFile.gcount());
-					if (!image) {
-						std::cerr << "Error writing audio data to image file for track: " << track.trackNumber << std::endl;
-						return;
-					}
-				}
+	dataOffset = uint64_t(wavFile.tellg());
+	dataSize = fs::file_size(wavPath) - dataOffset;
+}
 
-				wavFile.close();
+// Append the stored audio tracks to the image. The position of every track
+// in the image follows from the sizes of the WAV files before it, so the
+// tracks are copied by 'numJobs' threads at once, each to its own range.
+// When the image is being hashed, the tracks are instead streamed through
+// memory in order.
+void writeAudioTracks(std::vector<TrackInfo>& tracks, const std::filesystem::path& imageName, ImageWriter& image) {
+	struct AudioJob {
+		int trackNumber;
+		fs::path wavPath;
+		uint64_t dataOffset;
+		uint64_t dataSize;
+		uint64_t imageOffset;
+	};
+	std::vector<AudioJob> jobs;
+
+	image.flush();
+	uint64_t imageOffset = image.position();
+
+	auto addJob = [&](int trackNumber, const fs::path & wavPath) {
+		AudioJob job = { trackNumber, wavPath, 0, 0, imageOffset };
+		findWavData(wavPath, job.dataOffset, job.dataSize);
+		imageOffset += job.dataSize;
+		jobs.push_back(job);
+	};
 
+	for (const auto& track : tracks) {
+		if (track.trackType == "AUDIO") {
+			// Generate the WAV filename using the track information
+			// Process pregap if file exists
+			std::string wavFileName = std::format("Pregap_{:02}.wav", track.trackNumber);
+			std::filesystem::path fullPathWav = psxripDir / wavFileName;
+
+			if (fs::exists(fullPathWav)) {
+				addJob(track.trackNumber, fullPathWav);
 			}
 
 			// Process audio data
@@ -257,41 +341,42 @@ void writeAudioTracks(std::vector<TrackInfo>& tracks, const std::filesystem::pat
 
 			cdio_info("Writing WAV file: \"%s\" as audio track %2d...", wavFileName.c_str(), track.trackNumber);
 
-			wavFile.open(fullPathWav, std::ios::binary);
-			if (!wavFile) {
-				throw std::runtime_error("Error opening WAV file: " + fullPathWav.string());
-			}
-
-			wavFile.seekg(12);
-			dataChunkFound = false;
-
-			while (wavFile.read(chunkHeader, 4)) {
-				wavFile.read(reinterpret_cast<char*>(&chunkSize), sizeof(chunkSize));
+			addJob(track.trackNumber, fullPathWav);
+		}
+	}
 
-				if (std::strncmp(chunkHeader, "data", 4) == 0) {
-					dataChunkFound = true;
-					break;
-				}
+	if (imageHashes.enabled) {
+		std::vector<char> data(4 << 20);
+		int currentTrack = 0;
 
-				wavFile.seekg(chunkSize, std::ios::cur);
+		for (const auto& job : jobs) {
+			if (job.trackNumber != currentTrack) {
+				imageHashes.startTrack(job.trackNumber);
+				currentTrack = job.trackNumber;
 			}
 
-			if (!dataChunkFound) {
-				throw std::runtime_error("Invalid WAV file (missing 'data' chunk): " + fullPathWav.string());
-			}
+			std::ifstream wavFile(job.wavPath, std::ios::binary);
+			wavFile.seekg(job.dataOffset);
 
-			while (wavFile.read(buffer.data(), buffer.size()) || wavFile.gcount() > 0) {
-				image.write(buffer.data(), wavFile.gcount());
-				if (!image) {
-					std::cerr << "Error writing audio data to image file for track: " << track.trackNumber << std::endl;
-					return;
+			for (uint64_t done = 0; done < job.dataSize; ) {
+				size_t chunk = std::min<uint64_t>(data.size(), job.dataSize - done);
+				if (!wavFile.read(data.data(), chunk)) {
+					throw std::runtime_error("Error reading WAV file: " + job.wavPath.string());
 				}
-			}
-
-			wavFile.close();
 
+				image.writeAt(job.imageOffset + done, data.data(), chunk);
+				imageHashes.update(job.imageOffset + done, data.data(), chunk);
+				done += chunk;
+			}
 		}
+		return;
 	}
+
+	parallelFor(jobs.size(), numJobs, [&](size_t i) {
+		copyFileRange(jobs[i].wavPath, jobs[i].dataOffset, imageName, jobs[i].imageOffset, jobs[i].dataSize);
+	});
+
+	image.seek(imageOffset);
 }
 
 // Convert string to integer.
@@ -571,6 +656,9 @@ struct Catalog {
 
 	// Root directory of the filesystem tree
 	DirNode * root;
+
+	// Hashes of the tracks of the original image, by track number
+	map<int, RedumpHash::Values> trackHashes;
 };
 
 
@@ -702,6 +790,43 @@ static void parseSystemArea(ifstream & catalogFile, Catalog & cat)
 }
 
 
+// Parse the "track_hashes" section of the catalog file.
+static void parseTrackHashes(ifstream & catalogFile, Catalog & cat)
+{
+	while (true) {
+		string line = nextline(catalogFile);
+		if (line.empty()) {
+			throw runtime_error("Syntax error in catalog file: unterminated track_hashes section");
+		}
+
+		static const regex trackSpec("track\\s*(\\d+)\\s*size\\s*(\\d+)\\s*crc\\s*([0-9a-f]{8})\\s*md5\\s*([0-9a-f]{32})\\s*sha1\\s*([0-9a-f]{40})");
+		smatch m;
+
+		if (line == "}") {
+
+			// End of section
+			break;
+
+		} else if (regex_match(line, m, trackSpec)) {
+
+			// Track hashes specification
+			int track;
+			RedumpHash::Values hash;
+			if (! str_to_num(m[1], track) || ! str_to_num(m[2], hash.size)) {
+				throw runtime_error(format("Syntax error in catalog file: \"{}\" has an invalid number", line));
+			}
+			hash.crc = m[3];
+			hash.md5 = m[4];
+			hash.sha1 = m[5];
+			cat.trackHashes[track] = hash;
+
+		} else {
+			throw runtime_error(format("Syntax error in catalog file: \"{}\" unrecognized in track_hashes section", line));
+		}
+	}
+}
+
+
 // Parse the "volume" section of the catalog file.
 static void parseVolume(ifstream & catalogFile, Catalog & cat)
 {
@@ -886,8 +1011,8 @@ static DirNode * parseDir(ifstream & catalogFile, Catalog & cat, const string &
 			throw runtime_error(format("Syntax error in catalog file: unterminated directory section \"{}\"", dirName));
 		}
 
-		static const regex fileSpec        ("file\\s*(\\S+)(?:\\s*@(\\d+))?(?:\\s*GID(\\d+))?(?:\\s*UID(\\d+))?(?:\\s*ATR(\\d+))?(?:\\s*DATE(\\d+))?(?:\\s*TIMEZONE(\\d+))?(?:\\s*SIZE(\\d+))?(?:\\s*HIDDEN(\\d+))?(?:\\s*Y2KBUG(\\d+))?");
-		static const regex xaFileSpec    ("xafile\\s*(\\S+)(?:\\s*@(\\d+))?(?:\\s*GID(\\d+))?(?:\\s*UID(\\d+))?(?:\\s*ATR(\\d+))?(?:\\s*DATE(\\d+))?(?:\\s*TIMEZONE(\\d+))?(?:\\s*SIZE(\\d+))?(?:\\s*HIDDEN(\\d+))?(?:\\s*Y2KBUG(\\d+))?(?:\\s*ZEROEDC(\\d+))?");
+		static const regex fileSpec        ("file\\s*(\\S+)(?:\\s*@(\\d+))?(?:\\s*GID(\\d+))?(?:\\s*UID(\\d+))?(?:\\s*ATR(\\d+))?(?:\\s*DATE(\\d+))?(?:\\s*TIMEZONE(\\d+))?(?:\\s*SIZE(\\d+))?(?:\\s*HIDDEN(\\d+))?(?:\\s*Y2KBUG(\\d+))?(?:\\s*HASH([0-9a-f]{8}:[0-9a-f]{40}))?");
+		static const regex xaFileSpec    ("xafile\\s*(\\S+)(?:\\s*@(\\d+))?(?:\\s*GID(\\d+))?(?:\\s*UID(\\d+))?(?:\\s*ATR(\\d+))?(?:\\s*DATE(\\d+))?(?:\\s*TIMEZONE(\\d+))?(?:\\s*SIZE(\\d+))?(?:\\s*HIDDEN(\\d+))?(?:\\s*Y2KBUG(\\d+))?(?:\\s*ZEROEDC(\\d+))?(?:\\s*HASH([0-9a-f]{8}:[0-9a-f]{40}))?");
 		static const regex cddaFileSpec("cddafile\\s*(\\S+)(?:\\s*@(\\d+))?(?:\\s*GID(\\d+))?(?:\\s*UID(\\d+))?(?:\\s*ATR(\\d+))?(?:\\s*DATE(\\d+))?(?:\\s*TIMEZONE(\\d+))?(?:\\s*SIZE(\\d+))?(?:\\s*HIDDEN(\\d+))?(?:\\s*Y2KBUG(\\d+))?");
 		static const regex dirStart         ("dir\\s*(\\S+)(?:\\s*@(\\d+))?(?:\\s*GID(\\d+))?(?:\\s*UID(\\d+))?(?:\\s*ATRS(\\d+))?(?:\\s*ATRP(\\d+))?(?:\\s*DATES(\\d*))?(?:\\s*DATEP(\\d*))?(?:\\s*TIMEZONES(\\d+))?(?:\\s*TIMEZONEP(\\d+))?(?:\\s*HIDDEN(\\d+))?(?:\\s*Y2KBUG(\\d+))?\\s*\\{");
 		smatch m;
@@ -1010,6 +1135,7 @@ static void parseCatalog(ifstream & catalogFile, Catalog & cat, const fs::path &
 
 		static const regex systemAreaStart("system_area\\s*\\{");
 		static const regex volumeStart("volume\\s*\\{");
+		static const regex trackHashesStart("track_hashes\\s*\\{");
 		static const regex rootDirStart("dir\\s*(?:\\s*@(\\d+))?(?:\\s*GID(\\d+))?(?:\\s*UID(\\d+))?(?:\\s*ATRS(\\d+))?(?:\\s*ATRP(\\d+))?(?:\\s*DATES(\\d*))?(?:\\s*DATEP(\\d*))?(?:\\s*TIMEZONES(\\d+))?(?:\\s*TIMEZONEP(\\d+))?(?:\\s*HIDDEN(\\d+))?(?:\\s*Y2KBUG(\\d+))?\\s*\\{");
 		smatch m;
 
@@ -1023,6 +1149,11 @@ static void parseCatalog(ifstream & catalogFile, Catalog & cat, const fs::path &
 			// Parse volume section
 			parseVolume(catalogFile, cat);
 
+		} else if (regex_match(line, trackHashesStart)) {
+
+			// Parse track_hashes section
+			parseTrackHashes(catalogFile, cat);
+
 		} else if (regex_match(line, m, rootDirStart)) {
 				uint16_t nodeGID = std::stoi(m[2]);
 				uint16_t nodeUID = std::stoi(m[3]);
@@ -1299,101 +1430,783 @@ private:
 };
 
 
-// Visitor which writes all directory and file data to the image file
+// Writer which encodes Mode 2 sectors and appends them to the image file.
+// With a single job, each sector is encoded and written right away. With
+// more jobs, sectors are collected in batches which are encoded by a pool of
+// worker threads, and a writer thread drains the finished batches into the
+// image file in the order they were queued.
+class SectorWriter {
+public:
+	SectorWriter(ImageWriter & image_, unsigned numJobs_ = 1) : image(image_)
+	{
+		if (numJobs_ > 1) {
+			for (unsigned i = 0; i < numJobs_ * 2 + 2; ++i) {
+				pool.push_back(make_unique<Batch>());
+				freeBatches.push_back(pool.back().get());
+			}
+
+			for (unsigned i = 0; i < numJobs_; ++i) {
+				threads.emplace_back(&SectorWriter::encodeThread, this);
+			}
+			threads.emplace_back(&SectorWriter::writeThread, this);
+		}
+	}
+
+	~SectorWriter()
+	{
+		{
+			lock_guard<mutex> lock(m);
+			stopping = true;
+		}
+		workAvailable.notify_all();
+		batchEncoded.notify_all();
+
+		for (auto & t : threads) {
+			t.join();
+		}
+	}
+
+	// Queue a sector for writing. 'data' holds the payload of the sector
+	// (2324 bytes for Form 2, 2048 bytes otherwise). If 'zeroEDC' is set, the
+	// EDC of an encoded Form 2 sector is cleared.
+	void write(const void * data, uint32_t lsn, uint8_t fnum, uint8_t cnum, uint8_t sm, uint8_t ci, bool zeroEDC = false)
+	{
+		Request req;
+		memcpy(req.data, data, (sm & SM_FORM2) ? M2F2_SECTOR_SIZE : ISO_BLOCKSIZE);
+		req.lsn = lsn;
+		req.fnum = fnum;
+		req.cnum = cnum;
+		req.sm = sm;
+		req.ci = ci;
+		req.zeroEDC = zeroEDC;
+
+		if (threads.empty()) {
+			encode(frame, req);
+			writeFrames(image, req.lsn, frame, 1);
+			return;
+		}
+
+		acquire();
+		current->requests[current->count++] = req;
+		if (current->count == BATCH_SECTORS) {
+			submit();
+		}
+	}
+
+	// Queue an already encoded sector for writing at 'lsn'. Only the header
+	// of the frame is changed.
+	void writeEncoded(const void * raw, uint32_t lsn)
+	{
+		if (threads.empty()) {
+			memcpy(frame, raw, CDIO_CD_FRAMESIZE_RAW);
+			setMode2SectorAddress(frame, lsn);
+			writeFrames(image, lsn, frame, 1);
+			return;
+		}
+
+		acquire();
+		Request & req = current->requests[current->count];
+		req.lsn = lsn;
+		req.encoded = true;
+
+		char * out = current->frames + current->count * CDIO_CD_FRAMESIZE_RAW;
+		memcpy(out, raw, CDIO_CD_FRAMESIZE_RAW);
+		setMode2SectorAddress(out, lsn);
+
+		if (++current->count == BATCH_SECTORS) {
+			submit();
+		}
+	}
+
+	// Wait until all queued sectors have been written to the image file.
+	void flush()
+	{
+		if (threads.empty()) {
+			return;
+		}
+
+		if (current) {
+			submit();
+		}
+
+		unique_lock<mutex> lock(m);
+		batchFree.wait(lock, [this]{ return freeBatches.size() == pool.size(); });
+
+		if (error) {
+			rethrow_exception(error);
+		}
+	}
+
+private:
+	static constexpr size_t BATCH_SECTORS = 128;
+
+	// Payload and header information of one sector
+	struct Request {
+		uint8_t data[M2F2_SECTOR_SIZE];
+		uint32_t lsn;
+		uint8_t fnum, cnum, sm, ci;
+		bool zeroEDC;
+		bool encoded = false;  // frame is already in the batch
+	};
+
+	// Batch of sectors, together with the buffer for the encoded frames
+	struct Batch {
+		Request requests[BATCH_SECTORS];
+		char frames[BATCH_SECTORS * CDIO_CD_FRAMESIZE_RAW];
+		size_t count = 0;
+		bool encoded = false;
+	};
+
+	// Encode one sector into a raw frame.
+	static void encode(char * out, const Request & req)
+	{
+		encodeMode2Sector(out, req.data, req.lsn, req.fnum, req.cnum, req.sm, req.ci);
+		if (req.zeroEDC && (out[18] & SM_FORM2)) {  // Strip the EDC checksum of Form 2 sectors (Like Audio/Video/.STR/.XXA)
+			memset(out + 2348, 0, 4);
+		}
+	}
+
+	// Make sure there is a batch to be filled.
+	void acquire()
+	{
+		if (!current) {
+			unique_lock<mutex> lock(m);
+			batchFree.wait(lock, [this]{ return !freeBatches.empty(); });
+			current = freeBatches.back();
+			freeBatches.pop_back();
+
+			if (error) {
+				rethrow_exception(error);
+			}
+		}
+	}
+
+	// Hand the current batch over to the encoder and writer threads.
+	void submit()
+	{
+		{
+			lock_guard<mutex> lock(m);
+			encodeQueue.push_back(current);
+			writeQueue.push_back(current);
+		}
+		workAvailable.notify_one();
+		current = nullptr;
+	}
+
+	void encodeThread()
+	{
+		unique_lock<mutex> lock(m);
+
+		while (true) {
+			workAvailable.wait(lock, [this]{ return stopping || !encodeQueue.empty(); });
+			if (encodeQueue.empty()) {
+				return;
+			}
+
+			Batch * b = encodeQueue.front();
+			encodeQueue.pop_front();
+
+			lock.unlock();
+			for (size_t i = 0; i < b->count; ++i) {
+				if (!b->requests[i].encoded) {
+					encode(b->frames + i * CDIO_CD_FRAMESIZE_RAW, b->requests[i]);
+				}
+			}
+			lock.lock();
+
+			b->encoded = true;
+			batchEncoded.notify_all();
+		}
+	}
+
+	// Write the frames of a batch to their places in the image, one run of
+	// consecutive sectors at a time.
+	void writeBatch(const Batch * b)
+	{
+		size_t first = 0;
+		for (size_t i = 1; i <= b->count; ++i) {
+			if (i == b->count || b->requests[i].lsn != b->requests[i - 1].lsn + 1) {
+				writeFrames(image, b->requests[first].lsn, b->frames + first * CDIO_CD_FRAMESIZE_RAW, i - first);
+				first = i;
+			}
+		}
+	}
+
+	void writeThread()
+	{
+		unique_lock<mutex> lock(m);
+
+		while (true) {
+			batchEncoded.wait(lock, [this]{ return (!writeQueue.empty() && writeQueue.front()->encoded) || (stopping && writeQueue.empty()); });
+			if (writeQueue.empty()) {
+				return;
+			}
+
+			Batch * b = writeQueue.front();
+			writeQueue.pop_front();
+
+			// 'error' is shared with the main thread, so it is only accessed
+			// while holding the lock
+			bool failed = bool(error);
+			exception_ptr writeError;
+
+			lock.unlock();
+			if (!failed) {
+				try {
+					writeBatch(b);
+				} catch (...) {
+					writeError = current_exception();
+				}
+			}
+			lock.lock();
+
+			if (writeError) {
+				error = writeError;
+			}
+
+			b->count = 0;
+			b->encoded = false;
+			freeBatches.push_back(b);
+			batchFree.notify_all();
+		}
+	}
+
+	// Output image file
+	ImageWriter & image;
+
+	// Frame buffer for encoding on the main thread
+	char frame[CDIO_CD_FRAMESIZE_RAW];
+
+	// Worker threads (encoders followed by the writer)
+	vector<thread> threads;
+
+	// All batches, and the ones which are currently unused
+	vector<unique_ptr<Batch>> pool;
+	vector<Batch *> freeBatches;
+
+	// Batch being filled by write()
+	Batch * current = nullptr;
+
+	// Batches waiting to be encoded, and to be written (in sector order)
+	deque<Batch *> encodeQueue;
+	deque<Batch *> writeQueue;
+
+	mutex m;
+	condition_variable workAvailable;
+	condition_variable batchEncoded;
+	condition_variable batchFree;
+	bool stopping = false;
+
+	// First error which occurred in the writer thread
+	exception_ptr error;
+};
+
+
+// Background thread which asks the system to read the input files ahead of
+// the sector encoder, in the order in which they are written. It stays at
+// most 'window' bytes ahead of the data which has been consumed, so the
+// prefetched data is not evicted from the cache before it is used.
+class Prefetcher {
+public:
+	Prefetcher(uint64_t window_ = 64 * 1024 * 1024) : window(window_) { }
+
+	~Prefetcher()
+	{
+		{
+			lock_guard<mutex> lock(m);
+			stopping = true;
+		}
+		progress.notify_all();
+
+		if (worker.joinable()) {
+			worker.join();
+		}
+	}
+
+	// Add a range of a file to be prefetched. Must be called before start().
+	void add(const fs::path & path, uint64_t offset, uint64_t size)
+	{
+		for (uint64_t done = 0; done < size; done += CHUNK_SIZE) {
+			ranges.push_back({path, offset + done, min(size - done, CHUNK_SIZE)});
+		}
+	}
+
+	// Start prefetching the added ranges.
+	void start()
+	{
+		if (!ranges.empty()) {
+			worker = thread(&Prefetcher::run, this);
+		}
+	}
+
+	// Report that 'size' more bytes of the added ranges have been read.
+	void consumed(uint64_t size)
+	{
+		{
+			lock_guard<mutex> lock(m);
+			consumedBytes += size;
+		}
+		progress.notify_one();
+	}
+
+private:
+	// Files are prefetched in pieces of this size
+	static constexpr uint64_t CHUNK_SIZE = 4 * 1024 * 1024;
+
+	struct Range {
+		fs::path path;
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	void run()
+	{
+		uint64_t issuedBytes = 0;
+
+		for (const Range & r : ranges) {
+			{
+				unique_lock<mutex> lock(m);
+				progress.wait(lock, [&]{ return stopping || issuedBytes < consumedBytes + window; });
+				if (stopping) {
+					return;
+				}
+			}
+
+			prefetchFileRange(r.path, r.offset, r.size);
+			issuedBytes += r.size;
+		}
+	}
+
+	// Maximum number of bytes to prefetch ahead of the consumer
+	uint64_t window;
+
+	// Ranges to prefetch, in order
+	vector<Range> ranges;
+
+	thread worker;
+	mutex m;
+	condition_variable progress;
+	uint64_t consumedBytes = 0;
+	bool stopping = false;
+};
+
+
+// Size and modification time of a file, to detect changes between builds
+struct FileState {
+	string path;
+	uint64_t size = 0;
+	int64_t mtime = 0;
+
+	bool operator==(const FileState &) const = default;
+};
+
+
+// Return the current state of a file.
+static FileState fileState(const fs::path & path)
+{
+	FileState state;
+	state.path = path.generic_string();
+	state.size = fs::file_size(path);
+	state.mtime = int64_t(fs::last_write_time(path).time_since_epoch().count());
+	return state;
+}
+
+
+// Description of a built image, stored next to it as <output>.manifest by
+// incremental builds
+struct Manifest {
+	// SHA-1 over everything which determines the sector layout
+	string layout;
+
+	// State of the image file after the build
+	FileState image;
+
+	// Input files of the data track, by first sector
+	map<uint32_t, FileState> files;
+};
+
+
+// On-disk cache of the encoded sectors of input files. The EDC and ECC of
+// a Mode 2 sector don't cover its header, so the cached sectors of a file
+// can be reused at any position in the image by changing only the header.
+// Each entry holds the raw sectors of one file and is named after a SHA-1
+// over the path, size and modification time of the file and the way it is
+// encoded. The entries are kept in the subdirectory "psxbuild-sectors" of
+// the given directory, together with one index file per image which lists
+// the entries used by its last build. Entries which are not listed in any
+// index are removed.
+class SectorCache {
+public:
+	SectorCache(const fs::path & baseDir) : dir(baseDir / "psxbuild-sectors")
+	{
+		fs::create_directories(dir);
+	}
+
+	// Return the entry for a file in 'entry' and true if the cache holds it.
+	// The entry is kept in the cache in either case.
+	bool find(const FileNode & file, fs::path & entry)
+	{
+		string key = makeKey(file);
+		used.insert(key);
+
+		entry = dir / (key + ".bin");
+		error_code ec;
+		return fs::file_size(entry, ec) == uint64_t(file.numSectors) * CDIO_CD_FRAMESIZE_RAW;
+	}
+
+	// Add the sectors of a file to the cache when update() is called. The
+	// file must have been written to the image in full.
+	void add(const FileNode & file)
+	{
+		pending.push_back({makeKey(file), file.firstSector, file.numSectors});
+	}
+
+	// Copy the sectors of the added files from the finished image into the
+	// cache, record the entries used by the image in its index, and remove
+	// the entries which no image uses anymore.
+	void update(const fs::path & imageName)
+	{
+		for (const Pending & p : pending) {
+			fs::path entry = dir / (p.key + ".bin");
+			fs::path tempEntry = dir / (p.key + ".tmp");
+
+			ofstream(tempEntry, ofstream::out | ofstream::binary | ofstream::trunc).close();
+			copyFileRange(imageName, uint64_t(p.firstSector) * CDIO_CD_FRAMESIZE_RAW, tempEntry, 0, uint64_t(p.numSectors) * CDIO_CD_FRAMESIZE_RAW);
+			fs::rename(tempEntry, entry);
+		}
+
+		writeIndex(imageName);
+		removeUnused();
+
+		cdio_info("Added %zu file(s) to the sector cache", pending.size());
+	}
+
+private:
+	// Write the list of entries used by the image.
+	void writeIndex(const fs::path & imageName)
+	{
+		string imagePath = fs::absolute(imageName).generic_string();
+		SHA1 hash;
+		hash.update(imagePath.data(), imagePath.size());
+		string name = hash.hex();
+
+		fs::path tempIndex = dir / (name + ".index.tmp");
+		ofstream index(tempIndex, ofstream::out | ofstream::trunc);
+		index << imagePath << "\n";
+		for (const string & key : used) {
+			index << key << "\n";
+		}
+		index.close();
+		if (!index) {
+			throw runtime_error(format("Error writing to sector cache index {}", tempIndex.string()));
+		}
+
+		fs::rename(tempIndex, dir / (name + ".index"));
+	}
+
+	// Remove the entries which are not listed in any index. Only files
+	// named like cache entries are touched.
+	void removeUnused()
+	{
+		static const regex entrySpec("([0-9a-f]{40})\\.(bin|tmp)");
+		static const regex keySpec("[0-9a-f]{40}");
+
+		set<string> keep;
+		for (const auto & item : fs::directory_iterator(dir)) {
+			if (item.is_regular_file() && item.path().extension() == ".index") {
+				ifstream index(item.path());
+				string line;
+				while (getline(index, line)) {
+					if (regex_match(line, keySpec)) {
+						keep.insert(line);
+					}
+				}
+			}
+		}
+
+		for (const auto & item : fs::directory_iterator(dir)) {
+			smatch m;
+			string name = item.path().filename().string();
+			if (item.is_regular_file() && regex_match(name, m, entrySpec) && !keep.contains(m[1].str())) {
+				fs::remove(item.path());
+			}
+		}
+	}
+
+	static string makeKey(const FileNode & file)
+	{
+		FileState state = fileState(file.path);
+		string description = format("{}\n{}\n{} {}\n{} {} {}\n", TOOL_VERSION, state.path, state.size, state.mtime, file.numSectors, file.isForm2, file.nodeEDC);
+
+		SHA1 hash;
+		hash.update(description.data(), description.size());
+		return hash.hex();
+	}
+
+	struct Pending {
+		string key;
+		uint32_t firstSector;
+		uint32_t numSectors;
+	};
+
+	fs::path dir;
+
+	// Keys of the entries used by this build
+	set<string> used;
+
+	// Files to be added
+	vector<Pending> pending;
+};
+
+
+// Visitor which writes all directory and file data to the image file. The
+// visited nodes are collected and written in the order of their start
+// sectors, with empty sectors in the gaps between them, so the order of the
+// traversal doesn't matter. The input files are prefetched in that order
+// while the SectorWriter encodes and writes the preceding sectors.
 class WriteData : public Visitor {
 public:
-	WriteData(ofstream & image_, uint32_t startSector_) : image(image_), currentSector(startSector_) { }
+	WriteData(SectorWriter & writer_, uint32_t startSector_) : writer(writer_), currentSector(startSector_) { }
 
 	void visit(FileNode & file)
 	{
 		if (file.isAudio) { return; } // Do not write DA files back as audio tracks. Process seperately.
 
-		ifstream f(file.path, ifstream::in | ifstream::binary);
-		if (!f) {
-			throw runtime_error(format("Cannot open file {}", file.path.string()));
+		nodes.push_back(&file);
+	}
+
+	void visit(DirNode & dir)
+	{
+		nodes.push_back(&dir);
+	}
+
+	// Only write the directories, and the files whose first sectors are not
+	// in 'unchanged', leaving the rest of an existing image as it is.
+	void setIncremental(const set<uint32_t> & unchanged)
+	{
+		incremental = true;
+		unchangedFiles = unchanged;
+	}
+
+	// Take the sectors of unchanged files from 'cache', and add the others
+	// to it.
+	void setCache(SectorCache & cache_)
+	{
+		cache = &cache_;
+	}
+
+	// Number of files written
+	size_t getNumFilesWritten() const { return numFilesWritten; }
+
+	// Write the collected nodes, and the gaps up to 'endSector'.
+	void write(uint32_t endSector)
+	{
+		stable_sort(nodes.begin(), nodes.end(), [](FSNode * a, FSNode * b) {
+			return a->firstSector < b->firstSector;
+		});
+
+		// Look up the files in the sector cache
+		if (cache) {
+			for (FSNode * node : nodes) {
+				fs::path entry;
+				FileNode * file = dynamic_cast<FileNode *>(node);
+				if (file && cache->find(*file, entry)) {
+					cachedFiles[file] = entry;
+				}
+			}
 		}
 
-		cdio_info("Writing \"%ls\"...", file.path.c_str());
+		// Let the system read the files ahead while earlier sectors are
+		// being encoded and written
+		uint32_t sector = currentSector;
+		for (FSNode * node : nodes) {
+			FileNode * file = dynamic_cast<FileNode *>(node);
+			uint32_t first = firstNewSector(*node, sector);
+			if (file && first < file->numSectors && !isUnchanged(*file) && !cachedFiles.contains(file)) {
+				size_t blockSize = file->isForm2 ? M2RAW_SECTOR_SIZE : ISO_BLOCKSIZE;
+				prefetcher.add(file->path, uint64_t(first) * blockSize, uint64_t(file->numSectors - first) * blockSize);
+			}
+			sector = max(sector, node->firstSector + node->numSectors);
+		}
+		prefetcher.start();
+
+		for (FSNode * node : nodes) {
+			writeGap(node->firstSector);
+
+			if (FileNode * file = dynamic_cast<FileNode *>(node)) {
+				if (isUnchanged(*file)) {
+					currentSector = max(currentSector, file->firstSector + file->numSectors);
+				} else {
+					writeFile(*file);
+				}
+			} else {
+				writeDir(static_cast<DirNode &>(*node));
+			}
+		}
+
+		writeGap(endSector);
+	}
+
+	// New method for writing from a flat list
+	void writeFromFlatList(const std::vector<FSNode*>& flatList, uint32_t endSector)
+	{
+		for (auto* node : flatList) {
+			node->accept(*this);  // Call the appropriate visit method
+		}
+		write(endSector);
+	}
+
+private:
+	// Index of the first sector of a node which has not been written yet,
+	// when everything before sector 'written' has been. Sectors shared with
+	// a previous node (e.g. several directory entries for the same extent)
+	// are only written once.
+	static uint32_t firstNewSector(const FSNode & node, uint32_t written)
+	{
+		return min(max(written, node.firstSector) - node.firstSector, node.numSectors);
+	}
+
+	// Return true if the file is already present in the image.
+	bool isUnchanged(const FileNode & file) const
+	{
+		return incremental && unchangedFiles.contains(file.firstSector);
+	}
+
+	void writeFile(FileNode & file)
+	{
+		++numFilesWritten;
+
+		auto cached = cachedFiles.find(&file);
+		if (cached != cachedFiles.end()) {
+			writeCachedFile(file, cached->second);
+			return;
+		}
 
-		writeGap(file.firstSector);
+		MappedFile f(file.path);
+
+		cdio_info("Writing \"%ls\"...", file.path.c_str());
 
-		char data[M2RAW_SECTOR_SIZE];
 		size_t blockSize = file.isForm2 ? M2RAW_SECTOR_SIZE : ISO_BLOCKSIZE;
+		uint64_t unreported = 0;
 
-		for (uint32_t sector = 0; sector < file.numSectors; ++sector) {
+		uint32_t first = firstNewSector(file, currentSector);
+		if (cache && first == 0) {
+			cache->add(file);
+		}
+
+		for (uint32_t sector = first; sector < file.numSectors; ++sector) {
 			uint8_t subMode = SM_DATA;
 			if (sector == file.numSectors - 1) {
 				subMode |= (SM_EOF | SM_EOR);  // last sector
 			}
 
-			memset(data, 0, blockSize);
-			f.read(data, blockSize);
+			// Sector payloads are taken directly from the file contents,
+			// only the final partial sector is zero-padded
+			uint64_t offset = uint64_t(sector) * blockSize;
+			const char * data;
+			if (offset + blockSize <= f.size()) {
+				data = f.data() + offset;
+			} else {
+				memset(padded, 0, blockSize);
+				if (offset < f.size()) {
+					memcpy(padded, f.data() + offset, size_t(f.size() - offset));
+				}
+				data = padded;
+			}
 
+			uint32_t lsn = file.firstSector + sector;
 			if (file.isForm2) {
-				_vcd_make_mode2(buffer, data + CDIO_CD_SUBHEADER_SIZE, currentSector, data[0], data[1], data[2], data[3]);
-				if (file.nodeEDC == true) { // If the Mode 2 Form 2 files need to be stripped of their EDC checksum (Like Audio/Video/.STR/.XXA)
-					if ((buffer[18] & 0x20) == 0x20) {
-						buffer[2348] = '\0';
-						buffer[2349] = '\0';
-						buffer[2350] = '\0';
-						buffer[2351] = '\0';
-					}
-				}
+				// If the Mode 2 Form 2 files need to be stripped of their EDC checksum (Like Audio/Video/.STR/.XXA)
+				writer.write(data + CDIO_CD_SUBHEADER_SIZE, lsn, data[0], data[1], data[2], data[3], file.nodeEDC);
 			} else {
-				_vcd_make_mode2(buffer, data, currentSector, 0, 0, subMode, 0);
+				writer.write(data, lsn, 0, 0, subMode, 0);
 			}
 
-			image.write(buffer, CDIO_CD_FRAMESIZE_RAW);
-
-			++currentSector;
+			unreported += blockSize;
+			if (unreported >= PREFETCH_REPORT_SIZE) {
+				prefetcher.consumed(unreported);
+				unreported = 0;
+			}
 		}
+		prefetcher.consumed(unreported);
+
+		currentSector = max(currentSector, file.firstSector + file.numSectors);
 	}
 
-	void visit(DirNode & dir)
+	// Write the sectors of a file from its sector cache entry.
+	void writeCachedFile(FileNode & file, const fs::path & entry)
 	{
-		writeGap(dir.firstSector);
+		MappedFile f(entry);
+
+		cdio_info("Writing \"%ls\" from the sector cache...", file.path.c_str());
+
+		for (uint32_t sector = firstNewSector(file, currentSector); sector < file.numSectors; ++sector) {
+			writer.writeEncoded(f.data() + uint64_t(sector) * CDIO_CD_FRAMESIZE_RAW, file.firstSector + sector);
+		}
+
+		currentSector = max(currentSector, file.firstSector + file.numSectors);
+	}
 
-		for (uint32_t sector = 0; sector < dir.numSectors; ++sector) {
+	void writeDir(DirNode & dir)
+	{
+		for (uint32_t sector = firstNewSector(dir, currentSector); sector < dir.numSectors; ++sector) {
 			uint8_t subMode = SM_DATA;
 			if (sector == dir.numSectors - 1) {
 				subMode |= (SM_EOF | SM_EOR);  // last sector
 			}
 
-			_vcd_make_mode2(buffer, dir.data + sector * ISO_BLOCKSIZE, currentSector, 0, 0, subMode, 0);
-			image.write(buffer, CDIO_CD_FRAMESIZE_RAW);
-
-			++currentSector;
+			writer.write(dir.data + sector * ISO_BLOCKSIZE, dir.firstSector + sector, 0, 0, subMode, 0);
 		}
+
+		currentSector = max(currentSector, dir.firstSector + dir.numSectors);
 	}
 
-	// Write empty sectors as a gap until we reach the specified sector.
+	// Write empty sectors as a gap until we reach the specified sector. The
+	// gaps of an incremental build are already present in the image.
 	void writeGap(uint32_t until)
 	{
+		if (incremental) {
+			currentSector = max(currentSector, until);
+		}
+
 		while (currentSector < until) {
-			_vcd_make_mode2(buffer, emptySector, currentSector, 0, 0, SM_FORM2, 0);
-			image.write(buffer, CDIO_CD_FRAMESIZE_RAW);
+			writer.write(emptySector, currentSector, 0, 0, SM_FORM2, 0);
 
 			++currentSector;
 		}
 	}
 
-	// New method for writing from a flat list
-	void writeFromFlatList(const std::vector<FSNode*>& flatList)
-	{
-		for (auto* node : flatList) {
-			node->accept(*this);  // Call the appropriate visit method
-		}
-	}
+	// Amount of file data after which the progress is reported to the
+	// prefetcher
+	static constexpr uint64_t PREFETCH_REPORT_SIZE = 1024 * 1024;
 
-private:
-	ofstream & image;
+	SectorWriter & writer;
 	uint32_t currentSector;
+
+	// Nodes to be written
+	vector<FSNode *> nodes;
+
+	// Incremental build, and the first sectors of the files to be skipped
+	bool incremental = false;
+	set<uint32_t> unchangedFiles;
+
+	size_t numFilesWritten = 0;
+
+	// Sector cache, and the entries of the files found in it
+	SectorCache * cache = nullptr;
+	map<const FileNode *, fs::path> cachedFiles;
+
+	// Read-ahead of the input files
+	Prefetcher prefetcher;
+
+	// Buffer for the zero-padded final sector of a file
+	char padded[M2RAW_SECTOR_SIZE];
 };
 
 
 // Write the system area to the image file, optionally using the file
 // specified in the catalog as input.
-static void writeSystemArea(ofstream & image, const Catalog & cat)
+static void writeSystemArea(ImageWriter & image, const Catalog & cat)
 {
 	const size_t numSystemSectors = 16;
 	const size_t systemAreaSize = numSystemSectors * CDIO_CD_FRAMESIZE_RAW;
@@ -1401,8 +2214,6 @@ static void writeSystemArea(ofstream & image, const Catalog & cat)
 	unique_ptr<char[]> data(new char[systemAreaSize]);
 	memset(data.get(), 0, systemAreaSize);
 
-	size_t fileSize = 0;
-
 	if (!cat.systemAreaFile.empty()) {
 
 		// Copy the data (max. 32K) from the system area file
@@ -1411,27 +2222,203 @@ static void writeSystemArea(ofstream & image, const Catalog & cat)
 			throw runtime_error(format("Cannot open system area file \"{}\"", cat.systemAreaFile));
 		}
 
-		fileSize = f.read(data.get(), systemAreaSize).gcount();
+		f.read(data.get(), systemAreaSize);
 		if (f.bad()) {
 			throw runtime_error(format("Error reading system area file \"{}\"", cat.systemAreaFile));
 		}
 	}
 
-	size_t numFileSectors = (fileSize + CDIO_CD_FRAMESIZE_RAW - 1) / CDIO_CD_FRAMESIZE_RAW;
+	// Write system area to image file, the sectors not covered by the file
+	// are empty
+	writeFrames(image, 0, data.get(), numSystemSectors);
+}
+
+
+// Print the hashes of the tracks and of the whole image and write them to
+// the .hashes file. If the catalog has the hashes of the original image,
+// report whether the tracks match them.
+static void reportImageHashes(const Catalog & cat, const fs::path & hashesName)
+{
+	ofstream hashesFile(hashesName, ofstream::out | ofstream::trunc);
+	if (!hashesFile) {
+		throw runtime_error(format("Cannot create hashes file {}", hashesName.string()));
+	}
+
+	size_t numMatches = 0;
+
+	for (auto & [track, hash] : imageHashes.tracks) {
+		RedumpHash::Values values = hash.finish();
+
+		string line = format("track {:02}  {}", track, values.toString());
+		cout << line << "\n";
+		hashesFile << line << "\n";
+
+		if (cat.trackHashes.empty()) {
+			continue;
+		}
+
+		auto original = cat.trackHashes.find(track);
+		if (original == cat.trackHashes.end()) {
+			cout << "  not in catalog\n";
+		} else if (original->second == values) {
+			cout << "  match\n";
+			++numMatches;
+		} else {
+			cout << format("  MISMATCH: original has {}\n", original->second.toString());
+		}
+	}
+
+	string line = format("image     {}", imageHashes.image.finish().toString());
+	cout << line << "\n";
+	hashesFile << line << "\n";
+
+	if (!hashesFile) {
+		throw runtime_error(format("Error writing to hashes file {}", hashesName.string()));
+	}
+
+	if (!cat.trackHashes.empty()) {
+		if (numMatches == imageHashes.tracks.size() && numMatches == cat.trackHashes.size()) {
+			cout << "All tracks are identical to the original image\n";
+		} else {
+			cout << format("{} of {} tracks are identical to the original image\n", numMatches, cat.trackHashes.size());
+		}
+	}
+
+	cout << "Hashes written to " << hashesName << "..." << endl;
+}
+
+
+// Visitor which collects the nodes stored in the data track
+class CollectNodes : public Visitor {
+public:
+	void visit(FileNode & file)
+	{
+		if (!file.isAudio) {
+			nodes.push_back(&file);
+		}
+	}
+
+	void visit(DirNode & dir)
+	{
+		nodes.push_back(&dir);
+	}
+
+	vector<FSNode *> nodes;
+};
+
+
+// Describe the image to be built from the catalog. The layout hash covers
+// the positions and sizes of all directories and files, the track list
+// and the audio track files, but not the contents of the data track files,
+// whose states are recorded separately.
+static Manifest makeManifest(const Catalog & cat, uint32_t volumeSize)
+{
+	Manifest manifest;
+
+	CollectNodes collect;
+	cat.root->traverse(collect);
+	stable_sort(collect.nodes.begin(), collect.nodes.end(), [](FSNode * a, FSNode * b) {
+		return a->firstSector < b->firstSector;
+	});
+
+	string layout = format("{}\nvolume {} strict {}\n{}\n", TOOL_VERSION, volumeSize, strictRebuild, track_listing);
+
+	for (FSNode * node : collect.nodes) {
+		if (FileNode * file = dynamic_cast<FileNode *>(node)) {
+			layout += format("file {} {} {} {}\n", file->firstSector, file->numSectors, file->isForm2, file->nodeEDC);
+			manifest.files.emplace(file->firstSector, fileState(file->path));
+		} else {
+			layout += format("dir {} {}\n", node->firstSector, node->numSectors);
+		}
+	}
+
+	for (const TrackInfo & track : parseTracksFromString(track_listing)) {
+		if (track.trackType == "AUDIO") {
+			for (auto name : { format("Pregap_{:02}.wav", track.trackNumber), format("Track_{:02}.wav", track.trackNumber) }) {
+				fs::path wavPath = psxripDir / name;
+				if (fs::exists(wavPath)) {
+					FileState state = fileState(wavPath);
+					layout += format("audio {} {} {}\n", state.path, state.size, state.mtime);
+				}
+			}
+		}
+	}
+
+	SHA1 hash;
+	hash.update(layout.data(), layout.size());
+	manifest.layout = hash.hex();
+
+	return manifest;
+}
+
+
+// Read the manifest of a previous build. Returns false if the file doesn't
+// exist or cannot be parsed.
+static bool readManifest(const fs::path & manifestName, Manifest & manifest)
+{
+	ifstream file(manifestName);
+	if (!file) {
+		return false;
+	}
+
+	string line;
+	if (!getline(file, line) || line != "psxbuild manifest 1") {
+		return false;
+	}
+
+	while (getline(file, line)) {
+		istringstream fields(line);
+		string keyword;
+		fields >> keyword;
+
+		if (keyword == "layout") {
+			fields >> manifest.layout;
+		} else if (keyword == "image" || keyword == "file") {
+			uint32_t sector = 0;
+			if (keyword == "file") {
+				fields >> sector;
+			}
+
+			FileState state;
+			fields >> state.size >> state.mtime;
+			fields.get();  // separating space
+			getline(fields, state.path);
+
+			if (keyword == "image") {
+				manifest.image = state;
+			} else {
+				manifest.files.emplace(sector, state);
+			}
+		} else {
+			return false;
+		}
+
+		if (!fields && !fields.eof()) {
+			return false;
+		}
+	}
+
+	return !manifest.layout.empty();
+}
 
-	// Write system area to image file
-	for (size_t sector = 0; sector < numFileSectors; ++sector) {
 
-		// Data sectors
-		memcpy(buffer, data.get() + sector * CDIO_CD_FRAMESIZE_RAW, CDIO_CD_FRAMESIZE_RAW);
-		image.write(buffer, CDIO_CD_FRAMESIZE_RAW);
+// Write the manifest of the image.
+static void writeManifest(const fs::path & manifestName, const Manifest & manifest)
+{
+	ofstream file(manifestName, ofstream::out | ofstream::trunc);
+	if (!file) {
+		throw runtime_error(format("Cannot create manifest file {}", manifestName.string()));
 	}
 
-	for (size_t sector = numFileSectors; sector < numSystemSectors; ++sector) {
+	file << "psxbuild manifest 1\n";
+	file << "layout " << manifest.layout << "\n";
+	file << format("image {} {} {}\n", manifest.image.size, manifest.image.mtime, manifest.image.path);
+	for (auto & [sector, state] : manifest.files) {
+		file << format("file {} {} {} {}\n", sector, state.size, state.mtime, state.path);
+	}
 
-		// Empty sectors
-		memset(buffer, 0, CDIO_CD_FRAMESIZE_RAW);
-		image.write(buffer, CDIO_CD_FRAMESIZE_RAW);
+	if (!file) {
+		throw runtime_error(format("Error writing to manifest file {}", manifestName.string()));
 	}
 }
 
@@ -1441,6 +2428,16 @@ static void usage(const char * progname, int exitcode = 0, const string & error
 {
 	cout << "Usage: " << fs::path(progname).filename().string() << " [OPTION...] <input>[.cat] [<output>[.bin]]" << endl;
 	cout << "  -c, --cuefile                   Create a .cue file" << endl;
+	cout << "  -C, --cache DIR                 Keep the encoded sectors of the input files" << endl;
+	cout << "                                  in DIR and reuse them in later builds" << endl;
+	cout << "  -d, --direct-io                 Write the image with direct I/O, bypassing" << endl;
+	cout << "                                  the page cache" << endl;
+	cout << "  -H, --hash                      Hash the tracks while writing the image and" << endl;
+	cout << "                                  compare them with the catalog" << endl;
+	cout << "  -i, --incremental               Only rewrite the changed files and the" << endl;
+	cout << "                                  directories of an existing image" << endl;
+	cout << "  -j, --jobs N                    Encode sectors using N threads" << endl;
+	cout << "                                  (0 = number of CPU cores)" << endl;
 	cout << "  -v, --verbose                   Be verbose" << endl;
 	cout << "  -V, --version                   Display version information and exit" << endl;
 	cout << "  -?, --help                      Show this help message" << endl;
@@ -1461,6 +2458,9 @@ int main(int argc, char ** argv)
 	fs::path outputPath;
 	bool verbose = false;
 	bool writeCueFile = false;
+	bool directIO = false;
+	bool incremental = false;
+	fs::path cacheDir;
 
 	for (int i = 1; i < argc; ++i) {
 		string arg = argv[i];
@@ -1470,6 +2470,24 @@ int main(int argc, char ** argv)
 			return 0;
 		} else if (arg == "--cuefile" || arg == "-c") {
 			writeCueFile = true;
+		} else if (arg == "--cache" || arg == "-C") {
+			if (++i >= argc) {
+				usage(argv[0], 64, "Option '" + arg + "' requires a directory name");
+			}
+			cacheDir = argv[i];
+		} else if (arg == "--direct-io" || arg == "-d") {
+			directIO = true;
+		} else if (arg == "--hash" || arg == "-H") {
+			imageHashes.enabled = true;
+		} else if (arg == "--incremental" || arg == "-i") {
+			incremental = true;
+		} else if (arg == "--jobs" || arg == "-j") {
+			if (++i >= argc || !str_to_num(string(argv[i]), numJobs)) {
+				usage(argv[0], 64, "Option '" + arg + "' requires a number of jobs");
+			}
+			if (numJobs == 0) {
+				numJobs = max(thread::hardware_concurrency(), 1u);
+			}
 		} else if (arg == "--verbose" || arg == "-v") {
 			cdio_loglevel_default = CDIO_LOG_INFO;
 			verbose = true;
@@ -1492,6 +2510,10 @@ int main(int argc, char ** argv)
 		usage(argv[0], 64, "No input catalog file specified");
 	}
 
+	if (incremental && imageHashes.enabled) {
+		usage(argv[0], 64, "Options '--incremental' and '--hash' cannot be combined");
+	}
+
 	if (outputPath.empty()) {
 		outputPath = inputPath;
 		outputPath.replace_extension("");
@@ -1555,7 +2577,7 @@ int main(int argc, char ** argv)
 				return a->requestedStartSector < b->requestedStartSector;
 			});
 		} else {
-			cat.root->traverse(alloc);  // must use the same traversal order as "WriteData" below
+			cat.root->traverse(alloc);
 		}
 
 		uint32_t volumeSize = alloc.getCurrentSector();
@@ -1597,13 +2619,47 @@ int main(int argc, char ** argv)
 		fs::path imageCueName = outputPath;
 		imageCueName.replace_extension(".cue");
 
-		ofstream image(imageName, ofstream::out | ofstream::binary | ofstream::trunc);
-		if (!image) {
-			throw runtime_error(format("Error creating image file {}", imageName.string()));
+		// An incremental build updates the existing image in place if its
+		// layout hasn't changed since the build which wrote the manifest
+		fs::path manifestName = outputPath;
+		manifestName.replace_extension(".manifest");
+
+		Manifest manifest;
+		bool update = false;
+		set<uint32_t> unchangedFiles;
+
+		if (incremental) {
+			manifest = makeManifest(cat, volumeSize);
+
+			Manifest previous;
+			if (!readManifest(manifestName, previous)) {
+				cout << "No manifest of a previous build found, writing the full image...\n";
+			} else if (previous.layout != manifest.layout) {
+				cout << "Image layout has changed, writing the full image...\n";
+			} else if (!fs::exists(imageName) || fileState(imageName) != previous.image) {
+				cout << "Image file was modified after the previous build, writing the full image...\n";
+			} else {
+				update = true;
+				for (auto & [sector, state] : manifest.files) {
+					auto p = previous.files.find(sector);
+					if (p != previous.files.end() && p->second == state) {
+						unchangedFiles.insert(sector);
+					}
+				}
+			}
+		}
+
+		ImageWriter image(imageName, directIO, ImageWriter::DEFAULT_BUFFER_SIZE, update ? ImageWriter::UPDATE : ImageWriter::CREATE);
+
+		// Every sector is written at its final position, so the file can
+		// be allocated in one piece up front
+		if (!update) {
+			image.preallocate(uint64_t(volumeSize) * CDIO_CD_FRAMESIZE_RAW);
 		}
 
 		// Write the system area
 		cdio_info("Writing system area...");
+		imageHashes.startTrack(1);
 		writeSystemArea(image, cat);
 
 		// Write the PVD
@@ -1670,43 +2726,58 @@ int main(int argc, char ** argv)
 		volumeDesc.opt_type_l_path_table = to_731(pathTableStartSector + numPathTableSectors);
 		volumeDesc.opt_type_m_path_table = to_732(pathTableStartSector + numPathTableSectors * 3);
 
-		_vcd_make_mode2(buffer, &volumeDesc, pvdSector, 0, 0, SM_DATA | SM_EOR, 0);
-		image.write(buffer, CDIO_CD_FRAMESIZE_RAW);
+		encodeMode2Sector(buffer, &volumeDesc, pvdSector, 0, 0, SM_DATA | SM_EOR, 0);
+		writeFrames(image, pvdSector, buffer, 1);
 
 		// Write the volume descriptor set terminator
 		iso9660_set_evd(&volumeDesc);
 
-		_vcd_make_mode2(buffer, &volumeDesc, evdSector, 0, 0, SM_DATA | SM_EOF | SM_EOR, 0);
-		image.write(buffer, CDIO_CD_FRAMESIZE_RAW);
+		encodeMode2Sector(buffer, &volumeDesc, evdSector, 0, 0, SM_DATA | SM_EOF | SM_EOR, 0);
+		writeFrames(image, evdSector, buffer, 1);
 
 		// Write the path tables
 		cdio_info("Writing path tables...");
-		_vcd_make_mode2(buffer, pathTables.getLTable(), pathTableStartSector + numPathTableSectors * 0, 0, 0, SM_DATA | SM_EOF | SM_EOR, 0);
-		image.write(buffer, CDIO_CD_FRAMESIZE_RAW);
+		encodeMode2Sector(buffer, pathTables.getLTable(), pathTableStartSector + numPathTableSectors * 0, 0, 0, SM_DATA | SM_EOF | SM_EOR, 0);
+		writeFrames(image, pathTableStartSector + numPathTableSectors * 0, buffer, 1);
 
-		_vcd_make_mode2(buffer, pathTables.getLTable(), pathTableStartSector + numPathTableSectors * 1, 0, 0, SM_DATA | SM_EOF | SM_EOR, 0);
-		image.write(buffer, CDIO_CD_FRAMESIZE_RAW);
+		encodeMode2Sector(buffer, pathTables.getLTable(), pathTableStartSector + numPathTableSectors * 1, 0, 0, SM_DATA | SM_EOF | SM_EOR, 0);
+		writeFrames(image, pathTableStartSector + numPathTableSectors * 1, buffer, 1);
 
-		_vcd_make_mode2(buffer, pathTables.getMTable(), pathTableStartSector + numPathTableSectors * 2, 0, 0, SM_DATA | SM_EOF | SM_EOR, 0);
-		image.write(buffer, CDIO_CD_FRAMESIZE_RAW);
+		encodeMode2Sector(buffer, pathTables.getMTable(), pathTableStartSector + numPathTableSectors * 2, 0, 0, SM_DATA | SM_EOF | SM_EOR, 0);
+		writeFrames(image, pathTableStartSector + numPathTableSectors * 2, buffer, 1);
 
-		_vcd_make_mode2(buffer, pathTables.getMTable(), pathTableStartSector + numPathTableSectors * 3, 0, 0, SM_DATA | SM_EOF | SM_EOR, 0);
-		image.write(buffer, CDIO_CD_FRAMESIZE_RAW);
+		encodeMode2Sector(buffer, pathTables.getMTable(), pathTableStartSector + numPathTableSectors * 3, 0, 0, SM_DATA | SM_EOF | SM_EOR, 0);
+		writeFrames(image, pathTableStartSector + numPathTableSectors * 3, buffer, 1);
 
 		// Write the directory and file data
+		cdio_info("Encoding sectors with %u thread(s), %s P/Q parity and %s EDC kernels", numJobs, eccKernelName(), edcKernelName());
+		SectorWriter sectorWriter(image, numJobs);
+		unique_ptr<SectorCache> sectorCache;
+		WriteData writeData(sectorWriter, rootDirStartSector);
+		if (update) {
+			writeData.setIncremental(unchangedFiles);
+		}
+		if (!cacheDir.empty()) {
+			sectorCache = make_unique<SectorCache>(cacheDir);
+			writeData.setCache(*sectorCache);
+		}
 		if (strictRebuild == 1) {
-			WriteData writer(image, rootDirStartSector);
-			writer.writeFromFlatList(flatList);
+			writeData.writeFromFlatList(flatList, alloc.getCurrentSector());
 		} else {
-			WriteData writeData(image, rootDirStartSector);
-			cat.root->traverse(writeData);  // must use the same traversal order as "AllocSectors" above
+			cat.root->traverse(writeData);
+			writeData.write(alloc.getCurrentSector());
+		}
+		sectorWriter.flush();
+
+		if (update) {
+			cout << format("Rewriting {} changed file(s) of {}\n", writeData.getNumFilesWritten(), manifest.files.size());
 		}
 
 		// Write postgap. Usually 150 blank sectors which is standard.
 		fs::path lastSectorFilePath = psxripDir / "Last_sector.bin";
 		for (int i = 0; i < 150; i++) {
 			if (i == 149 && fs::exists(lastSectorFilePath)) {
-				_vcd_make_mode2(buffer, emptySectorRAW, i + alloc.getCurrentSector(), 0, 0, CN_EMPTY, 0);
+				encodeMode2Sector(buffer, emptySectorRAW, i + alloc.getCurrentSector(), 0, 0, CN_EMPTY, 0);
 				std::ifstream lastSectorFile(lastSectorFilePath, std::ios::binary);
 				if (lastSectorFile.is_open()) {
 					char fileSector[CDIO_CD_FRAMESIZE_RAW] = {0};
@@ -1717,13 +2788,13 @@ int main(int argc, char ** argv)
 				}
 			} else {
 				if (track1PostgapType == 1) {
-					_vcd_make_mode2(buffer, emptySectorRAW, i+alloc.getCurrentSector(), 0, 0, CN_EMPTY, 0); // Type 1 is empty
+					encodeMode2Sector(buffer, emptySectorRAW, i+alloc.getCurrentSector(), 0, 0, CN_EMPTY, 0); // Type 1 is empty
 				} else if (track1PostgapType == 2){
-					_vcd_make_mode2(buffer, emptySectorRAW, i+alloc.getCurrentSector(), 0, 0, SM_FORM2, 0); // Type 2 has Mode2 bytes set.
+					encodeMode2Sector(buffer, emptySectorRAW, i+alloc.getCurrentSector(), 0, 0, SM_FORM2, 0); // Type 2 has Mode2 bytes set.
 				} else if (track1PostgapType == 3){
-					_vcd_make_mode2(buffer, emptySectorRAW, i+alloc.getCurrentSector(), 0, 0, SM_FORM2, 0); // Type 3 has Mode2 bytes set and EDC.
+					encodeMode2Sector(buffer, emptySectorRAW, i+alloc.getCurrentSector(), 0, 0, SM_FORM2, 0); // Type 3 has Mode2 bytes set and EDC.
 				} else {
-					_vcd_make_mode2(buffer, emptySectorRAW, i+alloc.getCurrentSector(), 0, 0, CN_EMPTY, 0); // Unknown or Empty with garbage in last sector.
+					encodeMode2Sector(buffer, emptySectorRAW, i+alloc.getCurrentSector(), 0, 0, CN_EMPTY, 0); // Unknown or Empty with garbage in last sector.
 				}
 			}
 			if (buffer[18] == 0x20 && track1PostgapType != 3) { // Zero out the last 4 EDC bytes for type 2.
@@ -1732,26 +2803,40 @@ int main(int argc, char ** argv)
 				buffer[2350] = '\0';
 				buffer[2351] = '\0';
 			}
-			image.write(buffer, CDIO_CD_FRAMESIZE_RAW);
+			writeFrames(image, i + alloc.getCurrentSector(), buffer, 1);
 		}
 
 		// Parse the track information from the catalog file.
 		std::vector<TrackInfo> tracks = parseTracksFromString(track_listing);
 
-		// Append the stored .wav files.
-		writeAudioTracks(tracks, inputPath, image);
+		// Append the stored .wav files. An incremental build keeps them.
+		if (!update) {
+			writeAudioTracks(tracks, imageName, image);
+		}
 
 		// Write the .cue file
 		generateCueFile(tracks, imageName, imageCueName);
 
 		// Close the image file
-		if (!image) {
-			throw runtime_error(format("Error writing to image file {}", imageName.string()));
-		}
 		image.close();
 
 		cout << "Image file written to " << imageName << "..." << endl;
 
+		if (sectorCache) {
+			sectorCache->update(imageName);
+		}
+
+		if (incremental) {
+			manifest.image = fileState(imageName);
+			writeManifest(manifestName, manifest);
+		}
+
+		if (imageHashes.enabled) {
+			fs::path hashesName = outputPath;
+			hashesName.replace_extension(".hashes");
+			reportImageHashes(cat, hashesName);
+		}
+
 		cdio_info("Done.");
 
 	} catch (const std::exception & e) {
@@ -31,6 +31,9 @@ extern "C" {
 #include <libvcd/sector.h>
 }
 
+#include "cdsector.h"
+#include "isotree.h"
+
 #include <cstdint>
 #include <exception>
 #include <filesystem>
@@ -110,7 +113,8 @@ int main(int argc, char ** argv)
 			imagePath.replace_extension(".bin");
 		}
 
-		CdIo_t * image = cdio_open(imagePath.string().c_str(), DRIVER_BINCUE);
+		// Only the directory sectors and the file record are accessed
+		CdIo_t * image = cdio_open_am(imagePath.string().c_str(), DRIVER_BINCUE, "mmap-random");
 		if (image == NULL) {
 			throw runtime_error(format("Error opening input image {}, or image has wrong type", imagePath.string()));
 		}
@@ -131,14 +135,14 @@ int main(int argc, char ** argv)
 		bool imageIsMode2 = (trackFormat == TRACK_FORMAT_XA);
 
 		// Find the file in the image
-		if (!iso9660_fs_read_superblock(image, ISO_EXTENSION_NONE)) {
-			throw runtime_error("Error reading ISO 9660 volume information");
-		}
+		ISOTree tree(image);
 
-		iso9660_stat_t * stat = iso9660_fs_stat(image, (replFilePath + ";1").c_str());
-		if (!stat) {
+		uint32_t fileNode = tree.find(replFilePath);
+		if (fileNode == ISOTree::NOT_FOUND) {
 			throw runtime_error(format("Cannot find '{}' in image", replFilePath));
 		}
+
+		const iso9660_stat_t * stat = tree.node(fileNode).stat;
 		if (stat->type != iso9660_stat_s::_STAT_FILE) {
 			throw runtime_error(format("'{}' does not refer to a file", replFilePath));
 		}
@@ -181,76 +185,18 @@ int main(int argc, char ** argv)
 			                    newFileName.string(), numSectors, maxSectors, maxSectors * blockSize));
 		}
 
-		// Find the directory in the image
-		string dirPath = fs::path(replFilePath).parent_path().generic_string();
-		if (dirPath.empty()) {
-			dirPath = "/";
-		}
-
-		iso9660_stat_t * dirStat = iso9660_fs_stat(image, dirPath.c_str());
-		if (!dirStat) {
-			throw runtime_error(format("Cannot find '{}' in image", dirPath));
-		}
-		if (dirStat->type != iso9660_stat_s::_STAT_DIR) {
-			throw runtime_error(format("'{}' does not refer to a directory", dirPath));
-		}
-
-		// Scan the directory for the file record
-		uint32_t dirSector = dirStat->lsn;
-		uint32_t numDirSectors = dirStat->secsize;
-		size_t dirOffset = 0;
-		bool isLastDirSector = false;
+		// Read the sector holding the directory record of the file
+		const iso9660_stat_t * dirStat = tree.node(tree.node(fileNode).parent).stat;
 
-		string searchName = fs::path(replFilePath).filename().generic_string() + ";1";
-		bool found = false;
+		uint32_t dirSector = tree.node(fileNode).recordLSN;
+		size_t dirOffset = tree.node(fileNode).recordOffset;
+		bool isLastDirSector = (dirSector == dirStat->lsn + dirStat->secsize - 1);
 
 		uint8_t dirBuffer[ISO_BLOCKSIZE];
 
-		for (size_t sector = 0; sector < numDirSectors && !found; ++sector) {
-			if (sector == numDirSectors - 1) {
-				isLastDirSector = true;
-			}
-
-			driver_return_code_t r = cdio_read_data_sectors(image, dirBuffer, dirSector + sector, ISO_BLOCKSIZE, 1);
-			if (r != DRIVER_OP_SUCCESS) {
-				throw runtime_error(format("Error reading sector {} of image file: {}",
-				                    (dirSector + sector), cdio_driver_errmsg(r)));
-			}
-
-			size_t offset = 0;
-			while (offset < ISO_BLOCKSIZE) {
-
-				// Get record length
-				size_t recLen = dirBuffer[offset];
-				if (recLen == 0) {
-					offset++;  // empty padding at end of sector
-					continue;
-				}
-
-				// Get record type, skip directories
-				uint8_t type = dirBuffer[offset + offsetof(iso9660_dir_t, file_flags)];
-				if (type & ISO_DIRECTORY) {
-					offset += recLen;
-					continue;
-				}
-
-				// Compare file name
-				size_t nameLen = dirBuffer[offset + offsetof(iso9660_dir_t, filename)];
-				if (string((char *) dirBuffer + offset + offsetof(iso9660_dir_t, filename) + 1, nameLen) == searchName) {
-
-					// Found it
-					dirSector = dirSector + sector;
-					dirOffset = offset;
-					found = true;
-					break;
-				}
-
-				offset += recLen;
-			}
-		}
-
-		if (!found) {
-			throw runtime_error(format("'{}' not found in directory '{}'", searchName, dirPath));
+		driver_return_code_t r = cdio_read_data_sectors(image, dirBuffer, dirSector, ISO_BLOCKSIZE, 1);
+		if (r != DRIVER_OP_SUCCESS) {
+			throw runtime_error(format("Error reading sector {} of image file: {}", dirSector, cdio_driver_errmsg(r)));
 		}
 
 		// Reopen the image file for writing
@@ -282,9 +228,9 @@ int main(int argc, char ** argv)
 				}
 
 				if (fileIsForm2) {
-					_vcd_make_mode2(buffer, data + CDIO_CD_SUBHEADER_SIZE, extent + sector, data[0], data[1], data[2], data[3]);
+					encodeMode2Sector(buffer, data + CDIO_CD_SUBHEADER_SIZE, extent + sector, data[0], data[1], data[2], data[3]);
 				} else {
-					_vcd_make_mode2(buffer, data, extent + sector, 0, 0, subMode, 0);
+					encodeMode2Sector(buffer, data, extent + sector, 0, 0, subMode, 0);
 				}
 
 				writeImage.write((char *)buffer, CDIO_CD_FRAMESIZE_RAW);
@@ -306,7 +252,7 @@ int main(int argc, char ** argv)
 			if (isLastDirSector) {
 				subMode |= (SM_EOF | SM_EOR);  // last sector
 			}
-			_vcd_make_mode2(buffer, dirBuffer, dirSector, 0, 0, subMode, 0);
+			encodeMode2Sector(buffer, dirBuffer, dirSector, 0, 0, subMode, 0);
 			writeImage.write((char *)buffer, CDIO_CD_FRAMESIZE_RAW);
 		} else {
 			writeImage.write((char *)dirBuffer, ISO_BLOCKSIZE);
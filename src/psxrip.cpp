@@ -29,7 +29,17 @@ extern "C" {
 #include <libvcd/sector.h>
 }
 
+#include "cdsector.h"
+#include "edc.h"
+#include "filecopy.h"
+#include "hash.h"
+#include "isotree.h"
+#include "parallel.h"
+
 #include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
 #include <cstdint>
 #include <cstring>
 #include <exception>
@@ -38,10 +48,15 @@ extern "C" {
 #include <fstream>
 #include <iostream>
 #include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ranges>
 #include <regex>
 #include <string>
 #include <stdexcept>
 #include <stdio.h>
+#include <thread>
 #include <time.h>
 #include <vector>
 namespace fs = std::filesystem;
@@ -55,6 +70,7 @@ using namespace std;
 
 bool fixAllDates = false;
 bool writeStrict = false;
+unsigned numJobs = 1;
 
 fs::path psxripDir;
 
@@ -62,7 +78,6 @@ fs::path psxripDir;
 struct tm rootEntryReplacementTm;
 
 // Sector buffer
-static char buffer[M2RAW_SECTOR_SIZE];
 static char bufferRAW[CDIO_CD_FRAMESIZE_RAW];
 
 // Gzip compress and Base64 encode text string
@@ -154,6 +169,238 @@ static void print_ltime(ofstream & f, const iso9660_ltime_t & l, bool creation_t
 }
 
 
+// Convert string to integer.
+static bool str_to_num(const string & s, auto & value)
+{
+	auto end = s.data() + s.size();
+	auto result = from_chars(s.data(), end, value);
+	return result.ec == errc() && result.ptr == end;
+}
+
+
+// A track of the image with its hashes, as listed in Redump .dat files
+struct TrackHash {
+	track_t track;
+	lsn_t first;
+	lsn_t count;
+	RedumpHash::Values hash;
+};
+
+
+// Hashes of the tracks, computed from the raw frames which are read by the
+// dump anyway. The frames of a track have to be hashed in order, but the
+// dump reads them with several threads and skips the sectors which don't
+// belong to a file, so frames which arrive ahead of the hashed position are
+// kept until the frames before them have been hashed. The hasher reads only
+// the sectors which the dump doesn't read as raw frames (volume descriptors,
+// directories and unused sectors), and the frames which didn't fit into
+// memory.
+class TrackHasher {
+public:
+	TrackHasher(CdIo_t * image_, vector<TrackHash> & tracks_) : image(image_), tracks(tracks_), states(tracks_.size())
+	{
+		for (size_t i = 0; i < tracks.size(); ++i) {
+			states[i].next = tracks[i].first;
+			states[i].end = tracks[i].first + tracks[i].count;
+		}
+	}
+
+	// Announce that the dump is going to pass the given frames to add().
+	void expect(lsn_t first, lsn_t count)
+	{
+		forEachTrack(first, count, [](State & s, lsn_t trackFirst, lsn_t trackCount) {
+			lock_guard<mutex> lock(s.m);
+			s.expected.emplace(trackFirst, trackFirst + trackCount);
+		});
+	}
+
+	// Report that all frames of a track which the dump is going to pass to
+	// add() have been announced, so the hasher may read the others itself.
+	void expectNoMore(track_t track)
+	{
+		for (size_t i = 0; i < tracks.size(); ++i) {
+			if (tracks[i].track == track) {
+				lock_guard<mutex> lock(states[i].m);
+				states[i].sealed = true;
+				advance(states[i]);
+			}
+		}
+	}
+
+	// Add raw frames which have been read by the dump. This may be called
+	// from several threads at once.
+	void add(lsn_t first, const uint8_t * frames, lsn_t count)
+	{
+		forEachTrack(first, count, [&](State & s, lsn_t trackFirst, lsn_t trackCount) {
+			const uint8_t * trackFrames = frames + size_t(trackFirst - first) * CDIO_CD_FRAMESIZE_RAW;
+			lsn_t end = trackFirst + trackCount;
+
+			lock_guard<mutex> lock(s.m);
+			if (end <= s.next) {
+				return;  // already hashed
+			}
+
+			if (trackFirst <= s.next) {
+				hashFrames(s, trackFrames + size_t(s.next - trackFirst) * CDIO_CD_FRAMESIZE_RAW, end - s.next);
+				advance(s);
+				return;
+			}
+
+			// Keep frames which are ahead if there is room, otherwise they
+			// are read again when the hasher gets to them
+			size_t size = size_t(trackCount) * CDIO_CD_FRAMESIZE_RAW;
+			vector<uint8_t> & pending = s.pending[trackFirst];
+			if (size > pending.size() && pendingBytes + size - pending.size() <= MAX_PENDING_BYTES) {
+				pendingBytes += size - pending.size();
+				pending.assign(trackFrames, trackFrames + size);
+			} else if (pending.empty()) {
+				s.pending.erase(trackFirst);
+			}
+		});
+	}
+
+	// Report that the dump of frames announced with expect() has finished,
+	// successfully or not.
+	void done(lsn_t first, lsn_t count)
+	{
+		forEachTrack(first, count, [this](State & s, lsn_t trackFirst, lsn_t trackCount) {
+			lock_guard<mutex> lock(s.m);
+			auto [begin, end] = s.expected.equal_range(trackFirst);
+			auto e = find_if(begin, end, [&](const auto & range) { return range.second == trackFirst + trackCount; });
+			if (e != end) {
+				s.expected.erase(e);
+			}
+			advance(s);
+		});
+	}
+
+	// Hash the frames which the dump has not read and store the hashes in
+	// the tracks.
+	void finish()
+	{
+		for (size_t i = 0; i < tracks.size(); ++i) {
+			State & s = states[i];
+
+			lock_guard<mutex> lock(s.m);
+			s.sealed = true;
+			s.expected.clear();
+			advance(s);
+
+			if (!s.error.empty()) {
+				throw runtime_error(s.error);
+			}
+			tracks[i].hash = s.hash.finish();
+		}
+	}
+
+private:
+	// Frames kept in memory ahead of the hashed positions at most
+	static constexpr size_t MAX_PENDING_BYTES = 64 * 1024 * 1024;
+
+	// Frames read by the hasher at once
+	static constexpr lsn_t MAX_CHUNK_SECTORS = 512;
+
+	struct State {
+		lsn_t next = 0;                          // next frame to be hashed
+		lsn_t end = 0;                           // end of the track
+		RedumpHash hash;
+		multimap<lsn_t, lsn_t> expected;         // start -> end of frames to be passed by the dump
+		map<lsn_t, vector<uint8_t>> pending;     // frames which arrived ahead of 'next'
+		bool sealed = false;                     // 'expected' is complete
+		string error;                            // the track could not be read
+		vector<uint8_t> buffer;
+		mutex m;
+	};
+
+	// Call 'func' with the part of the frames which falls into each track.
+	template <typename Func>
+	void forEachTrack(lsn_t first, lsn_t count, Func func)
+	{
+		for (size_t i = 0; i < tracks.size(); ++i) {
+			lsn_t trackFirst = max(first, tracks[i].first);
+			lsn_t trackEnd = min(first + count, tracks[i].first + tracks[i].count);
+			if (trackFirst < trackEnd) {
+				func(states[i], trackFirst, trackEnd - trackFirst);
+			}
+		}
+	}
+
+	// Hash the frames at the current position of the track.
+	static void hashFrames(State & s, const uint8_t * frames, lsn_t count)
+	{
+		s.hash.update(frames, size_t(count) * CDIO_CD_FRAMESIZE_RAW);
+		s.next += count;
+	}
+
+	// Hash as many frames of the track as possible: pending frames, and
+	// frames which the dump is not going to pass. Called with the lock of
+	// the track held.
+	void advance(State & s)
+	{
+		while (s.next < s.end && s.error.empty()) {
+
+			// Hash the pending frames at the current position, drop the ones
+			// which are behind it
+			auto p = s.pending.begin();
+			if (p != s.pending.end() && p->first <= s.next) {
+				lsn_t end = p->first + lsn_t(p->second.size() / CDIO_CD_FRAMESIZE_RAW);
+				if (end > s.next) {
+					hashFrames(s, p->second.data() + size_t(s.next - p->first) * CDIO_CD_FRAMESIZE_RAW, end - s.next);
+				}
+				pendingBytes -= p->second.size();
+				s.pending.erase(p);
+				continue;
+			}
+
+			// Wait for the dump if it is going to pass the current frame
+			lsn_t holeEnd = s.end;
+			for (auto e = s.expected.begin(); e != s.expected.end(); ) {
+				if (e->second <= s.next) {
+					e = s.expected.erase(e);
+				} else if (e->first <= s.next) {
+					return;
+				} else {
+					holeEnd = e->first;
+					break;
+				}
+			}
+
+			if (!s.sealed) {
+				return;
+			}
+
+			if (!s.pending.empty()) {
+				holeEnd = min(holeEnd, s.pending.begin()->first);
+			}
+
+			// Read the frames up to the next ones to be passed by the dump
+			lsn_t count = min(holeEnd - s.next, MAX_CHUNK_SECTORS);
+
+			const uint8_t * frames = cdio_get_raw_sectors(image, s.next, count);
+			if (!frames) {
+				s.buffer.resize(size_t(count) * CDIO_CD_FRAMESIZE_RAW);
+				driver_return_code_t r = cdio_pread_raw_sectors(image, s.buffer.data(), s.next, count);
+				if (r != DRIVER_OP_SUCCESS) {
+					s.error = format("Error reading sector {} of image file: {}", s.next, cdio_driver_errmsg(r));
+					return;
+				}
+				frames = s.buffer.data();
+			}
+
+			hashFrames(s, frames, count);
+		}
+	}
+
+	CdIo_t * image;
+	vector<TrackHash> & tracks;
+	vector<State> states;
+	atomic<size_t> pendingBytes = 0;
+};
+
+// Hashes of the tracks being dumped, if requested
+static TrackHasher * trackHasher = nullptr;
+
+
 // Dump system area data from image to file.
 static void dumpSystemArea(CdIo_t * image, const fs::path & fileName)
 {
@@ -162,41 +409,547 @@ static void dumpSystemArea(CdIo_t * image, const fs::path & fileName)
 		throw runtime_error(format("Cannot create system area file {}\n", fileName.string()));
 	}
 
-	const size_t numSystemAreaSectors = 16;
-	for (size_t sector = 0; sector < numSystemAreaSectors; ++sector) {
-		driver_return_code_t r = cdio_read_audio_sector(image, bufferRAW, sector);
+	// Read the raw frames of the system area in one go, straight from a
+	// memory-mapped image if possible
+	const uint32_t numSystemAreaSectors = 16;
+	vector<uint8_t> buffer(numSystemAreaSectors * CDIO_CD_FRAMESIZE_RAW);
+
+	const uint8_t * frames = cdio_get_raw_sectors(image, 0, numSystemAreaSectors);
+	if (!frames) {
+		driver_return_code_t r = cdio_pread_raw_sectors(image, buffer.data(), 0, numSystemAreaSectors);
 		if (r != DRIVER_OP_SUCCESS) {
-			throw runtime_error(format("Error reading sector {} of image file: {}", sector, cdio_driver_errmsg(r)));
+			throw runtime_error(format("Error reading system area of image file: {}", cdio_driver_errmsg(r)));
 		}
+		frames = buffer.data();
+	}
+
+	if (trackHasher) {
+		trackHasher->add(0, frames, numSystemAreaSectors);
+	}
+
+	file.write(reinterpret_cast<const char *>(frames), numSystemAreaSectors * CDIO_CD_FRAMESIZE_RAW);
+	if (!file) {
+		throw runtime_error(format("Cannot write to system area file {}", fileName.string()));
+	}
+}
 
-		file.write(bufferRAW, CDIO_CD_FRAMESIZE_RAW);
+
+// An audio track or pregap to be dumped to a WAV file
+struct AudioJob {
+	lsn_t first;
+	lsn_t count;
+	fs::path fileName;
+};
+
+
+// Write the raw frames 'first' to 'first' + 'count' - 1 of the image to a
+// WAV file. The PCM data is copied straight from the .bin file to the WAV
+// file where possible, otherwise, or if the tracks are hashed, it is read in
+// large chunks. This may be called from several threads at once.
+static void dumpAudioTrack(CdIo_t * image, lsn_t first, lsn_t count, const fs::path & fileName)
+{
+	static const uint8_t wavHeader[44] = {
+		'R', 'I', 'F', 'F', 0, 0, 0, 0, // Chunk ID and Chunk Size (to be set)
+		'W', 'A', 'V', 'E',             // Format
+		'f', 'm', 't', ' ',             // Subchunk1 ID
+		16, 0, 0, 0,                    // Subchunk1 Size (16 for PCM)
+		1, 0,                           // Audio Format (1 for PCM)
+		2, 0,                           // Num Channels (2 for stereo)
+		0x44, 0xAC, 0x00, 0x00,         // Sample Rate (44100 Hz)
+		0x10, 0xB1, 0x02, 0x00,         // Byte Rate (44100 * 2 * 16/8)
+		4, 0,                           // Block Align (NumChannels * BitsPerSample/8)
+		16, 0,                          // Bits per Sample (16)
+		'd', 'a', 't', 'a', 0, 0, 0, 0  // Subchunk2 ID and Subchunk2 Size (to be set)
+	};
+
+	// Copy the static header and set file-specific sizes
+	uint32_t dataSize = count * CDIO_CD_FRAMESIZE_RAW;
+
+	uint8_t header[sizeof(wavHeader)];
+	memcpy(header, wavHeader, sizeof(header));
+	*(uint32_t *)(header + 4) = 36 + dataSize; // Chunk Size
+	*(uint32_t *)(header + 40) = dataSize;     // Subchunk2 Size
+
+	ofstream file(fileName, ofstream::out | ofstream::binary | ofstream::trunc);
+	if (!file) {
+		throw runtime_error(format("Cannot create audio file {}", fileName.string()));
+	}
+
+	file.write((char *)header, sizeof(header));
+	if (!file) {
+		throw runtime_error(format("Cannot write to audio file {}", fileName.string()));
+	}
+
+	// The frames of a track are normally one byte range of a .bin file,
+	// which is copied without passing through libcdio
+	const char * firstFile, * lastFile;
+	uint64_t firstOffset, lastOffset;
+
+	if (!trackHasher && count > 0 && cdio_get_raw_sector_file(image, first, &firstFile, &firstOffset) == DRIVER_OP_SUCCESS &&
+	    cdio_get_raw_sector_file(image, first + count - 1, &lastFile, &lastOffset) == DRIVER_OP_SUCCESS &&
+	    strcmp(firstFile, lastFile) == 0 && lastOffset == firstOffset + uint64_t(count - 1) * CDIO_CD_FRAMESIZE_RAW) {
+		file.close();
+		copyFileRange(firstFile, firstOffset, fileName, sizeof(header), dataSize);
+		return;
+	}
+
+	const lsn_t maxChunkSectors = 512;
+	vector<uint8_t> buffer(min(count, maxChunkSectors) * CDIO_CD_FRAMESIZE_RAW);
+
+	for (lsn_t sector = 0; sector < count; ) {
+		lsn_t chunk = min(count - sector, maxChunkSectors);
+
+		driver_return_code_t r = cdio_pread_raw_sectors(image, buffer.data(), first + sector, chunk);
+		if (r != DRIVER_OP_SUCCESS) {
+			throw runtime_error(format("Error reading sector {} of image file: {}", first + sector, cdio_driver_errmsg(r)));
+		}
+
+		if (trackHasher) {
+			trackHasher->add(first + sector, buffer.data(), chunk);
+		}
+
+		file.write((char *)buffer.data(), chunk * CDIO_CD_FRAMESIZE_RAW);
 		if (!file) {
-			throw runtime_error(format("Cannot write to system area file {}", fileName.string()));
+			throw runtime_error(format("Cannot write to audio file {}", fileName.string()));
 		}
+
+		sector += chunk;
+	}
+
+	if (trackHasher) {
+		trackHasher->done(first, count);
 	}
 }
 
 
-// Functor for sorting a container of iso9660_stat_t pointers by LSN
-struct CmpByLSN {
-	bool operator()(const iso9660_stat_t * lhs, const iso9660_stat_t * rhs)
-	{
-		return lhs->lsn < rhs->lsn;
+// Check the EDC of all sectors of the data track up to and including
+// 'lastSector', and report the sectors which fail the check.
+static void verifyEDC(CdIo_t * image, lsn_t lastSector)
+{
+	cout << "Verifying EDC of data track...\n";
+
+	const lsn_t chunkSectors = 64;
+	vector<uint8_t> chunk(chunkSectors * CDIO_CD_FRAMESIZE_RAW);
+	size_t numErrors = 0, numZero = 0;
+
+	for (lsn_t sector = 0; sector <= lastSector; sector += chunkSectors) {
+		lsn_t count = min(chunkSectors, lastSector - sector + 1);
+
+		// Check memory-mapped images in place
+		const uint8_t * frames = cdio_get_raw_sectors(image, sector, count);
+		if (!frames) {
+			driver_return_code_t r = cdio_read_audio_sectors(image, chunk.data(), sector, count);
+			if (r != DRIVER_OP_SUCCESS) {
+				throw runtime_error(format("Error reading sector {} of image file: {}", sector, cdio_driver_errmsg(r)));
+			}
+			frames = chunk.data();
+		}
+
+		if (trackHasher) {
+			trackHasher->add(sector, frames, count);
+		}
+
+		for (lsn_t i = 0; i < count; ++i) {
+			switch (checkSectorEDC(frames + i * CDIO_CD_FRAMESIZE_RAW)) {
+				case EDC_ERROR:
+					cerr << format("EDC error in sector {}", sector + i) << endl;
+					++numErrors;
+					break;
+				case EDC_ZERO:
+					++numZero;
+					break;
+				default:
+					break;
+			}
+		}
+	}
+
+	cdio_info("%zu form 2 sectors with zeroed-out EDC", numZero);
+	cout << format("{} sectors checked, {} EDC errors\n", lastSector + 1, numErrors);
+}
+
+
+// Append the hashes of the tracks to the catalog file, so psxbuild can
+// check whether the rebuilt image is identical to the original one.
+static void appendTrackHashes(const fs::path & catalogName, const vector<TrackHash> & tracks)
+{
+	ofstream catalog(catalogName, ofstream::out | ofstream::app);
+	if (!catalog) {
+		throw runtime_error(format("Cannot open catalog file {}", catalogName.string()));
+	}
+
+	catalog << "\ntrack_hashes {\n";
+	for (const TrackHash & t : tracks) {
+		catalog << format("  track {:02}  {}\n", t.track, t.hash.toString());
 	}
+	catalog << "}\n";
+
+	if (!catalog) {
+		throw runtime_error(format("Cannot write to catalog file {}", catalogName.string()));
+	}
+}
+
+
+// A .bin file entry of a Redump .dat file
+struct DatRom {
+	string game;
+	string name;
+	RedumpHash::Values hash;
 };
 
 
+// Replace the predefined XML entities in an attribute value.
+static string xmlUnescape(const string & s)
+{
+	static const pair<string, string> entities[] = {
+		{ "&lt;", "<" }, { "&gt;", ">" }, { "&quot;", "\"" }, { "&apos;", "'" }, { "&amp;", "&" }
+	};
+
+	string result = s;
+	for (const auto & [entity, c] : entities) {
+		for (size_t pos = 0; (pos = result.find(entity, pos)) != string::npos; pos += c.size()) {
+			result.replace(pos, entity.size(), c);
+		}
+	}
+	return result;
+}
+
+
+// Read the .bin file entries of all games from a Redump .dat (Logiqx XML)
+// file.
+static vector<DatRom> readDatFile(const fs::path & datPath)
+{
+	ifstream file(datPath);
+	if (!file) {
+		throw runtime_error(format("Cannot open .dat file {}", datPath.string()));
+	}
+
+	static const regex gameTag("<game\\s[^>]*name=\"([^\"]*)\"");
+	static const regex romTag("<rom\\s([^>]*)>");
+	static const regex attribute("(\\w+)=\"([^\"]*)\"");
+
+	vector<DatRom> roms;
+	string game;
+	string line;
+	smatch m;
+
+	while (getline(file, line)) {
+		if (regex_search(line, m, gameTag)) {
+			game = xmlUnescape(m[1]);
+		}
+
+		if (!regex_search(line, m, romTag)) {
+			continue;
+		}
+
+		DatRom rom;
+		rom.game = game;
+
+		string attributes = m[1];
+		for (sregex_iterator a(attributes.begin(), attributes.end(), attribute), end; a != end; ++a) {
+			string key = (*a)[1], value = (*a)[2];
+			if (key == "name") {
+				rom.name = xmlUnescape(value);
+			} else if (key == "size") {
+				str_to_num(value, rom.hash.size);
+			} else if (key == "crc") {
+				rom.hash.crc = value;
+			} else if (key == "md5") {
+				rom.hash.md5 = value;
+			} else if (key == "sha1") {
+				rom.hash.sha1 = value;
+			}
+		}
+
+		// Skip the .cue sheets
+		if (fs::path(rom.name).extension() == ".bin") {
+			ranges::transform(rom.hash.crc, rom.hash.crc.begin(), ::tolower);
+			ranges::transform(rom.hash.md5, rom.hash.md5.begin(), ::tolower);
+			ranges::transform(rom.hash.sha1, rom.hash.sha1.begin(), ::tolower);
+			roms.push_back(rom);
+		}
+	}
+
+	cdio_info("%zu track entries read from %s", roms.size(), datPath.string().c_str());
+	return roms;
+}
+
+
+// Print the hashes of the tracks and, if a .dat file was given, whether
+// they match its entries. A track which doesn't match is compared to the
+// entry for the same track of the game which matches the most tracks.
+static void reportTrackHashes(const vector<TrackHash> & tracks, const vector<DatRom> & roms, bool haveDat)
+{
+	auto matches = [](const TrackHash & t, const DatRom & r) {
+		return t.hash == r.hash;
+	};
+
+	// Find the game with the most matching tracks
+	map<string, size_t> gameMatches;
+	for (const DatRom & r : roms) {
+		if (ranges::any_of(tracks, [&](const TrackHash & t) { return matches(t, r); })) {
+			++gameMatches[r.game];
+		}
+	}
+
+	string bestGame;
+	size_t bestCount = 0;
+	for (const auto & [game, count] : gameMatches) {
+		if (count > bestCount) {
+			bestGame = game;
+			bestCount = count;
+		}
+	}
+
+	vector<const DatRom *> bestRoms;
+	for (const DatRom & r : roms) {
+		if (r.game == bestGame) {
+			bestRoms.push_back(&r);
+		}
+	}
+
+	size_t numMatches = 0;
+	for (size_t i = 0; i < tracks.size(); ++i) {
+		const TrackHash & t = tracks[i];
+		cout << format("Track {:02}  {}\n", t.track, t.hash.toString());
+
+		if (!haveDat) {
+			continue;
+		}
+
+		// Prefer the entry of the best-matching game
+		const DatRom * match = nullptr;
+		auto best = ranges::find_if(bestRoms, [&](const DatRom * r) { return matches(t, *r); });
+		if (best != bestRoms.end()) {
+			match = *best;
+		} else {
+			auto any = ranges::find_if(roms, [&](const DatRom & r) { return matches(t, r); });
+			if (any != roms.end()) {
+				match = &*any;
+			}
+		}
+
+		if (match) {
+			cout << format("  match: {}\n", match->name);
+			++numMatches;
+		} else if (i < bestRoms.size()) {
+			const DatRom & r = *bestRoms[i];
+			cout << format("  MISMATCH: expected {} with {}\n", r.name, r.hash.toString());
+		} else {
+			cout << "  MISMATCH: not found in .dat file\n";
+		}
+	}
+
+	if (haveDat) {
+		if (numMatches == tracks.size() && bestRoms.size() == tracks.size()) {
+			cout << format("All {} tracks match \"{}\"\n", tracks.size(), bestGame);
+		} else if (bestCount > 0) {
+			cout << format("{} of {} tracks match, closest game in .dat file is \"{}\" with {} tracks\n",
+			               numMatches, tracks.size(), bestGame, bestRoms.size());
+		} else {
+			cout << "No track matches the .dat file\n";
+		}
+	}
+}
+
+
+// Dump the extent of a file to 'file', reading and writing it in chunks of
+// many sectors. The file data is cut out of the raw frames at 'dataOffset',
+// Form 2 files are dumped with their subheaders. The image is only read
+// with positional reads, so several threads may dump files from the same
+// image at once. The written data is added to 'crc' and 'sha1', and the raw
+// frames to the track hashes. Returns
+// true if a Form 2 sector with zeroed-out EDC was found.
+static bool dumpFileExtent(CdIo_t * image, lsn_t extent, uint32_t numSectors, bool form2File, size_t dataOffset,
+                           size_t fileSize, ofstream & file, const fs::path & outputFileName, CRC32 & crc, SHA1 & sha1)
+{
+	const uint32_t maxChunkSectors = 256;
+	size_t blockSize = form2File ? M2RAW_SECTOR_SIZE : ISO_BLOCKSIZE;
+	size_t frameOffset = form2File ? CDIO_CD_SYNC_SIZE + CDIO_CD_HEADER_SIZE : dataOffset;
+
+	vector<uint8_t> rawBuffer(maxChunkSectors * CDIO_CD_FRAMESIZE_RAW);
+	vector<char> data(maxChunkSectors * blockSize);
+
+	size_t sizeRemaining = fileSize;
+	bool zeroEDC = false;
+
+	uint32_t chunkSectors = maxChunkSectors;
+	uint32_t sector = 0;
+
+	while (sector < numSectors) {
+		uint32_t count = min(chunkSectors, numSectors - sector);
+		lsn_t lsn = extent + sector;
+		driver_return_code_t r = DRIVER_OP_SUCCESS;
+
+		// Take the raw frames straight from a memory-mapped image if possible
+		const uint8_t * frames = cdio_get_raw_sectors(image, lsn, count);
+		if (!frames) {
+			r = cdio_pread_raw_sectors(image, rawBuffer.data(), lsn, count);
+			frames = rawBuffer.data();
+		}
+
+		if (r == DRIVER_OP_SUCCESS) {
+			if (trackHasher) {
+				trackHasher->add(lsn, frames, count);
+			}
+
+			for (uint32_t i = 0; i < count; ++i) {
+				const uint8_t * frame = frames + i * CDIO_CD_FRAMESIZE_RAW;
+
+				// Check for EDC status. Tricky one as XA files can have audio and video sectors.
+				// Mode 2-1/Mode 2-2 interleaved. So until a positive hit, keep scanning.
+				if (form2File && !zeroEDC && checkSectorEDC(frame) == EDC_ZERO) {
+					zeroEDC = true;
+				}
+
+				memcpy(data.data() + i * blockSize, frame + frameOffset, blockSize);
+			}
+		}
+
+		if (r != DRIVER_OP_SUCCESS) {
+			if (count > 1) {
+
+				// Retry sector by sector, to dump everything up to the bad one
+				chunkSectors = 1;
+				continue;
+			}
+
+			cerr << format("Error reading sector {} of image file: {}", lsn, cdio_driver_errmsg(r)) << endl;
+			cerr << format("Output file {} may be incomplete", outputFileName.string()) << endl;
+			break;
+		}
+
+		size_t sizeToWrite = min(sizeRemaining, count * blockSize);
+
+		file.write(data.data(), sizeToWrite);
+		if (!file) {
+			throw runtime_error(format("Cannot write to file {}", outputFileName.string()));
+		}
+
+		crc.update(data.data(), sizeToWrite);
+		sha1.update(data.data(), sizeToWrite);
+
+		sizeRemaining -= sizeToWrite;
+		sector += count;
+	}
+
+	return zeroEDC;
+}
+
+
+// Written to the catalog in place of the hash of a file until it has been
+// extracted
+static const string HASH_PLACEHOLDER = string(8, '0') + ":" + string(40, '0');
+
+
+// A file to be extracted from the image
+struct ExtractJob {
+	lsn_t extent;
+	uint32_t numSectors;
+	size_t fileSize;
+	bool form2File;
+	fs::path outputFileName;
+	streampos zeroEDCPos;  // position of the ZEROEDC flag in the catalog
+	bool zeroEDC = false;
+	streampos hashPos;     // position of the HASH value in the catalog
+	string hash;           // "<crc32>:<sha1>" of the extracted data
+};
+
+
+// Extract one file from the image.
+static void extractFile(CdIo_t * image, ExtractJob & job, size_t dataOffset)
+{
+	ofstream file(job.outputFileName, ofstream::out | ofstream::binary | ofstream::trunc);
+	if (!file) {
+		throw runtime_error(format("Cannot create output file {}", job.outputFileName.string()));
+	}
+
+	CRC32 crc;
+	SHA1 sha1;
+	job.zeroEDC = dumpFileExtent(image, job.extent, job.numSectors, job.form2File, dataOffset, job.fileSize, file, job.outputFileName, crc, sha1);
+	job.hash = crc.hex() + ":" + sha1.hex();
+
+	if (trackHasher) {
+		trackHasher->done(job.extent, job.numSectors);
+	}
+}
+
+
+// Extract the files collected by dumpFilesystem() with 'numJobs' threads,
+// which all read from the one image handle, and fill in their ZEROEDC flags
+// and hashes in the catalog.
+static void extractFiles(CdIo_t * image, vector<ExtractJob> & jobs, ofstream & catalog)
+{
+	// Extract the files in the order in which they are stored, so that the
+	// image is read once from front to back instead of directory by
+	// directory
+	ranges::sort(jobs, {}, &ExtractJob::extent);
+
+	// The file data is all the track hasher gets from the dump of the data
+	// track after the system area
+	track_t dataTrack = cdio_get_first_track_num(image);
+	if (trackHasher) {
+		for (const auto & job : jobs) {
+			trackHasher->expect(job.extent, job.numSectors);
+		}
+		trackHasher->expectNoMore(dataTrack);
+	}
+
+	// Offset of the user data of Form 1 sectors in the raw frames
+	bool imageIsMode2 = cdio_get_track_format(image, dataTrack) == TRACK_FORMAT_XA;
+	size_t dataOffset = imageIsMode2 ? CDIO_CD_XA_SYNC_HEADER : CDIO_CD_SYNC_SIZE + CDIO_CD_HEADER_SIZE;
+
+	size_t numThreads = min<size_t>(numJobs, jobs.size());
+	if (numThreads > 1) {
+		cdio_info("Extracting %zu files with %zu threads", jobs.size(), numThreads);
+	}
+
+	parallelFor(jobs.size(), numThreads, [&](size_t i) {
+		extractFile(image, jobs[i], dataOffset);
+	});
+
+	// Fill in the ZEROEDC flags, which were written as 0, and the hashes,
+	// which were written as placeholders of the same length
+	for (auto & job : jobs) {
+		if (job.form2File && job.zeroEDC) {
+			catalog.seekp(job.zeroEDCPos);
+			catalog << '1';
+		}
+
+		catalog.seekp(job.hashPos);
+		catalog << job.hash;
+	}
+	catalog.seekp(0, ios_base::end);
+}
+
+
+// Return the entries of directory 'dir' of the tree sorted by sector number.
+static vector<uint32_t> sortedChildren(const ISOTree & tree, uint32_t dir)
+{
+	const ISOTree::Node & node = tree.node(dir);
+
+	vector<uint32_t> children(node.numChildren);
+	for (uint32_t i = 0; i < node.numChildren; ++i) {
+		children[i] = node.firstChild + i;
+	}
+
+	ranges::sort(children, {}, [&tree](uint32_t i) { return tree.node(i).stat->lsn; });
+	return children;
+}
+
+
 // Recursively dump the contents of the ISO filesystem starting at 'dir'
-// while extending the catalog file.
-static void dumpFilesystem(CdIo_t * image, ofstream & catalog, bool writeLBNs,
-						   const fs::path & outputPath, const string & inputPath = "",
+// while extending the catalog file. The files to be extracted are added
+// to 'jobs'.
+static void dumpFilesystem(ISOTree & tree, ofstream & catalog, vector<ExtractJob> & jobs, bool writeLBNs,
+						   const fs::path & outputPath, uint32_t dir = ISOTree::ROOT, const string & inputPath = "",
 						   const string & dirName = "", unsigned level = 0)
 {
 	cdio_info("Dumping '%s' as '%s'", inputPath.c_str(), dirName.c_str());
 
-	// Read the directory entries
-	CdioList_t * entries = iso9660_fs_readdir(image, inputPath.c_str());
-	if (!entries) {
+	// The directory entries start with "." and ".."
+	const ISOTree::Node & dirNode = tree.node(dir);
+	if (dirNode.numChildren < 2) {
 		throw runtime_error(format("Error reading ISO 9660 directory '{}'", inputPath));
 	}
 
@@ -205,14 +958,12 @@ static void dumpFilesystem(CdIo_t * image, ofstream & catalog, bool writeLBNs,
 	fs::create_directory(outputDirName);
 
 	// Open the catalog record for the directory
-	CdioListNode_t *node = _cdio_list_begin(entries);
-
 	time_t directoryEpochSelf, directoryEpochParent;
 	char datestringSelf[32], datestringParent[32];
 	int y2k = 0;
 
 	// Process first directory entry "."
-	iso9660_stat_t *statSelf = static_cast<iso9660_stat_t *>(_cdio_list_node_data(node));
+	iso9660_stat_t *statSelf = tree.node(dirNode.firstChild).stat;
 	// Fix broken Y2K dates and the mess libcdio makes with that.
 	if (statSelf->tm.tm_year < 70) {
 		statSelf->tm.tm_year = rootEntryReplacementTm.tm_year;
@@ -233,10 +984,8 @@ static void dumpFilesystem(CdIo_t * image, ofstream & catalog, bool writeLBNs,
 		y2k += 1;
 	}
 
-	node = _cdio_list_node_next(node);
-
 	// Process second directory entry ".."
-	iso9660_stat_t *statParent = static_cast<iso9660_stat_t *>(_cdio_list_node_data(node));
+	iso9660_stat_t *statParent = tree.node(dirNode.firstChild + 1).stat;
 	if (statParent->tm.tm_year < 70) {
 		statParent->tm.tm_year = rootEntryReplacementTm.tm_year;
 		statParent->tm.tm_mon = rootEntryReplacementTm.tm_mon;
@@ -290,20 +1039,10 @@ static void dumpFilesystem(CdIo_t * image, ofstream & catalog, bool writeLBNs,
 		catalog << " {\n";
 	}
 
-	// Sort entries by sector number
-	vector<iso9660_stat_t *> sortedChildren;
-
-	CdioListNode_t * entry;
-	_CDIO_LIST_FOREACH(entry, entries) {
-		sortedChildren.push_back(static_cast<iso9660_stat_t *>(_cdio_list_node_data(entry)));
-	}
-
-	sort(sortedChildren.begin(), sortedChildren.end(), CmpByLSN());
-
-	// Dump all entries
-	for (vector<iso9660_stat_t *>::const_iterator i = sortedChildren.begin(); i != sortedChildren.end(); ++i) {
-		iso9660_stat_t * stat = *i;
-		string entryName = stat->filename;
+	// Dump all entries, sorted by sector number
+	for (uint32_t child : sortedChildren(tree, dir)) {
+		iso9660_stat_t * stat = tree.node(child).stat;
+		string entryName(tree.name(child));
 		string entryPath = inputPath.empty() ? entryName : (inputPath + "/" + entryName);
 
 		char datestringEntry[32];
@@ -317,17 +1056,11 @@ static void dumpFilesystem(CdIo_t * image, ofstream & catalog, bool writeLBNs,
 
 			// Entry is a directory, recurse into it unless it is "." or ".."
 			if (entryName != "." && entryName != "..") {
-				dumpFilesystem(image, catalog, writeLBNs, outputDirName, entryPath, entryName, level + 1);
+				dumpFilesystem(tree, catalog, jobs, writeLBNs, outputDirName, child, entryPath, entryName, level + 1);
 			}
 
 		} else {
 
-			// Entry is a file, strip the version number
-			size_t versionSep = entryName.find_last_of(';');
-			if (versionSep != string::npos) {
-				entryName = entryName.substr(0, versionSep);
-			}
-
 			// Is it an XA form 2 file?
 			bool form2File = false;
 			bool cddaFile = false;
@@ -367,69 +1100,37 @@ static void dumpFilesystem(CdIo_t * image, ofstream & catalog, bool writeLBNs,
 			catalog << " HIDDEN" << stat->hidden;
 			catalog << " Y2KBUG" << stat->y2kbug;
 
-			// Dump the file contents
+			// Queue the file contents for extraction. The ZEROEDC flag and
+			// the hash are filled in when the file has been extracted.
 			fs::path outputFileName = outputDirName / entryName;
-			ofstream file(outputFileName, ofstream::out | ofstream::binary | ofstream::trunc);
-			if (!file) {
-				throw runtime_error(format("Cannot create output file {}", outputFileName.string()));
-			}
 
-			size_t sizeRemaining = fileSize;
-
-			bool edcTest = false;
+			if (cddaFile && !form2File) {
+				cdio_info("Skipping CD-DA file...");
+				ofstream file(outputFileName, ofstream::out | ofstream::binary | ofstream::trunc);
+				if (!file) {
+					throw runtime_error(format("Cannot create output file {}", outputFileName.string()));
+				}
+			} else {
+				ExtractJob job = { stat->lsn, stat->secsize, fileSize, form2File, outputFileName };
 
-			for (uint32_t sector = 0; sector < stat->secsize; ++sector) {
-				driver_return_code_t r;
 				if (form2File) {
-					// Check for EDC status. Tricky one as XA files can have audio and video sectors. Mode 2-1/Mode 2-2 interleaved. So until a positive hit, keep scanning.
-					if (edcTest == false) {
-						r = cdio_read_audio_sector(image, bufferRAW, stat->lsn + sector);
-						if (r != DRIVER_OP_SUCCESS) {
-							cerr << format("Error reading sector {} of image file: {}", stat->lsn + sector, cdio_driver_errmsg(r)) << endl;
-							cerr << format("Output file {} may be incomplete", outputFileName.string()) << endl;
-							break;
-						}
-						if ((bufferRAW[18] & 0x20) == 0x20 && bufferRAW[2348] == '\0' && bufferRAW[2349] == '\0' && bufferRAW[2350] == '\0' &&	bufferRAW[2351] == '\0') { // If bit 6 is "1" and the last 4 bytes are "0" then its Mode 2/Form 2 with zeroed out EDC.
-							edcTest = true;
-						}
-					}
-					r = cdio_read_mode2_sector(image, buffer, stat->lsn + sector, 1);
-				} else if (cddaFile) {
-					cdio_info("Skipping CD-DA file...");
-					break;
-				} else {
-					r = cdio_read_data_sectors(image, buffer, stat->lsn + sector, blockSize, 1);
+					catalog << " ZEROEDC";
+					job.zeroEDCPos = catalog.tellp();
+					catalog << "0";
 				}
-				if (r != DRIVER_OP_SUCCESS) {
-					cerr << format("Error reading sector {} of image file: {}", stat->lsn + sector, cdio_driver_errmsg(r)) << endl;
-					cerr << format("Output file {} may be incomplete", outputFileName.string()) << endl;
-					break;
-				}
-
-				size_t sizeToWrite = sizeRemaining > blockSize ? blockSize : sizeRemaining;
 
-				file.write(buffer, sizeToWrite);
-				if (!file) {
-					throw runtime_error(format("Cannot write to file {}", outputFileName.string()));
-				}
+				catalog << " HASH";
+				job.hashPos = catalog.tellp();
+				catalog << HASH_PLACEHOLDER;
 
-				sizeRemaining -= sizeToWrite;
-			}
-			if (edcTest == true && form2File) {
-			 	catalog << " ZEROEDC" << "1";
-			 	edcTest = false;
-			} else if (form2File) {
-			 	catalog << " ZEROEDC" << "0";
+				jobs.push_back(move(job));
 			}
 			catalog << " \n";
-			file.close();
 		}
 	}
 
 	// Close the catalog record for the directory
 	catalog << string(level * 2, ' ') << "}\n";
-
-	_cdio_list_free(entries, true, (CdioDataFree_t) iso9660_stat_free);
 }
 
 
@@ -488,12 +1189,12 @@ static void dumpImage(CdIo_t * image, const fs::path & outputPath, bool writeLBN
 	catalog << "}\n\n";
 
 	// Dump ISO filesystem
-	if (!iso9660_fs_read_superblock(image, ISO_EXTENSION_NONE)) {
-		throw runtime_error("Error reading ISO 9660 volume information");
-	}
+	ISOTree tree(image);
 
 	cout << "Dumping filesystem to directory " << outputPath << "...\n";
-	dumpFilesystem(image, catalog, writeLBNs, outputPath);
+	vector<ExtractJob> jobs;
+	dumpFilesystem(tree, catalog, jobs, writeLBNs, outputPath);
+	extractFiles(image, jobs, catalog);
 
 	// Close down
 	cout << "Catalog written to " << catalogName << "\n";
@@ -501,11 +1202,10 @@ static void dumpImage(CdIo_t * image, const fs::path & outputPath, bool writeLBN
 
 
 // Dump an LBN table of the image to the given output stream.
-static void dumpLBNTable(CdIo_t * image, const string & inputPath = "", ostream & output = cout)
+static void dumpLBNTable(const ISOTree & tree, uint32_t dir = ISOTree::ROOT, const string & inputPath = "", ostream & output = cout)
 {
-	// Read the directory entries
-	CdioList_t * entries = iso9660_fs_readdir(image, inputPath.c_str());
-	if (!entries) {
+	const ISOTree::Node & dirNode = tree.node(dir);
+	if (dirNode.numChildren == 0) {
 		throw runtime_error(format("Error reading ISO 9660 directory '{}'", inputPath));
 	}
 
@@ -515,36 +1215,21 @@ static void dumpLBNTable(CdIo_t * image, const string & inputPath = "", ostream
 	}
 
 	// Print entry for directory itself
-	iso9660_stat_t * stat = static_cast<iso9660_stat_t *>(_cdio_list_node_data(_cdio_list_begin(entries)));  // "." entry
+	const iso9660_stat_t * stat = tree.node(dirNode.firstChild).stat;  // "." entry
 	output << format("{:08x} {:08x} {:08x} d {}", stat->lsn, stat->secsize, stat->size, inputPath) << endl;
 
-	// Sort entries by sector number
-	vector<iso9660_stat_t *> sortedChildren;
-
-	CdioListNode_t * entry;
-	_CDIO_LIST_FOREACH(entry, entries) {
-		sortedChildren.push_back(static_cast<iso9660_stat_t *>(_cdio_list_node_data(entry)));
-	}
-
-	sort(sortedChildren.begin(), sortedChildren.end(), CmpByLSN());
-
-	// Print all directory entries
-	for (vector<iso9660_stat_t *>::const_iterator i = sortedChildren.begin(); i != sortedChildren.end(); ++i) {
-		stat = *i;
-
-		string entryName = stat->filename;
-		size_t versionSep = entryName.find_last_of(';');
-		if (versionSep != string::npos) {
-			entryName = entryName.substr(0, versionSep);  // strip version number
-		}
+	// Print all directory entries, sorted by sector number
+	for (uint32_t child : sortedChildren(tree, dir)) {
+		stat = tree.node(child).stat;
 
+		string entryName(tree.name(child));
 		string entryPath = inputPath.empty() ? entryName : (inputPath + "/" + entryName);
 
 		if (stat->type == iso9660_stat_s::_STAT_DIR) {
 
 			// Entry is a directory, recurse into it unless it is "." or ".."
 			if (entryName != "." && entryName != "..") {
-				dumpLBNTable(image, entryPath, output);
+				dumpLBNTable(tree, child, entryPath, output);
 			}
 
 		} else {
@@ -574,8 +1259,14 @@ static void dumpLBNTable(CdIo_t * image, const string & inputPath = "", ostream
 static void usage(const char * progname, int exitcode = 0, const string & error = "")
 {
 	cout << "Usage: " << fs::path(progname).filename().string() << " [OPTION...] <input>[.bin/cue] [<output_dir>]" << endl;
+	cout << "  -d, --dat FILE                  Match track hashes against Redump .dat FILE" << endl;
+	cout << "                                  (implies -H)" << endl;
+	cout << "  -e, --verify-edc                Verify the EDC of all data track sectors" << endl;
 	cout << "  -f, --fix                       Fix problematic file/directory/catalog dates" << endl;
 	cout << "                                  instead of preserving them" << endl;
+	cout << "  -H, --hash                      Print CRC32, MD5 and SHA-1 of each track" << endl;
+	cout << "  -j, --jobs N                    Extract files using N threads" << endl;
+	cout << "                                  (0 = number of CPU cores)" << endl;
 	cout << "  -l, --lbns                      Write LBNs to catalog file" << endl;
 	cout << "  -s, --strict                    Rebuild writes to original LBN. Implied -l." << endl;
 	cout << "                                  Oversized files get remapped." << endl;
@@ -600,6 +1291,9 @@ int main(int argc, const char ** argv)
 	fs::path outputPath;
 	bool writeLBNs = false;
 	bool printLBNTable = false;
+	bool checkEDC = false;
+	bool hashTracks = false;
+	fs::path datPath;
 
 	for (int i = 1; i < argc; ++i) {
 		string arg = argv[i];
@@ -607,8 +1301,25 @@ int main(int argc, const char ** argv)
 		if (arg == "--version" || arg == "-V") {
 			cout << TOOL_VERSION << endl;
 			return 0;
+		} else if (arg == "--dat" || arg == "-d") {
+			if (++i >= argc) {
+				usage(argv[0], 64, "Option '" + arg + "' requires a .dat file name");
+			}
+			datPath = argv[i];
+			hashTracks = true;
+		} else if (arg == "--verify-edc" || arg == "-e") {
+			checkEDC = true;
 		} else if (arg == "--fix" || arg == "-f") {
 			fixAllDates = true;
+		} else if (arg == "--hash" || arg == "-H") {
+			hashTracks = true;
+		} else if (arg == "--jobs" || arg == "-j") {
+			if (++i >= argc || !str_to_num(string(argv[i]), numJobs)) {
+				usage(argv[0], 64, "Option '" + arg + "' requires a number of jobs");
+			}
+			if (numJobs == 0) {
+				numJobs = max(thread::hardware_concurrency(), 1u);
+			}
 		} else if (arg == "--lbns" || arg == "-l") {
 			writeLBNs = true;
 		} else if (arg == "--strict" || arg == "-s") {
@@ -637,6 +1348,10 @@ int main(int argc, const char ** argv)
 		usage(argv[0], 64, "No input image specified");
 	}
 
+	if (printLBNTable && hashTracks) {
+		usage(argv[0], 64, "Option '--lbn-table' cannot be combined with '--hash' or '--dat'");
+	}
+
 	if (outputPath.empty()) {
 		outputPath = inputPath;
 		outputPath.replace_extension("");
@@ -646,6 +1361,12 @@ int main(int argc, const char ** argv)
 
 	try {
 
+		// Read the .dat file before the lengthy dump
+		vector<DatRom> roms;
+		if (!datPath.empty()) {
+			roms = readDatFile(datPath);
+		}
+
 		// Open the input image (Force .cue extension on input argument! Libcdio will moan otherwise.)
 		inputPath.replace_extension(".cue");
 
@@ -712,7 +1433,10 @@ int main(int argc, const char ** argv)
 		cdio_info("Libcdio track parser:");
 		cdio_info("Track  Index 00  Index 01  Silence  Start LBA  Pregap  Data LBA  End LBA   Total  Filename");
 
- 		CdIo_t * image = cdio_open(inputPath.generic_string().c_str(), DRIVER_BINCUE);
+ 		// The image is read front to back when dumping, and with scattered
+		// lookups when only printing the LBN table
+		CdIo_t * image = cdio_open_am(inputPath.generic_string().c_str(), DRIVER_BINCUE,
+		                              printLBNTable ? "mmap-random" : "mmap-sequential");
 
 		if (image == NULL) {
 			throw runtime_error(format("Error opening input image {}, or image has wrong type", inputPath.string()));
@@ -731,6 +1455,8 @@ int main(int argc, const char ** argv)
 		discmode_t discMode = cdio_get_discmode(image);
 		const char *track1Format = "";
 		std::string csvTracks = "";
+		vector<AudioJob> audioJobs;
+		vector<TrackHash> trackHashes;
 
 		cdio_info("PSXRip track reparser:");
 		cdio_info("Track  Filesystem  Sector type      Start LBA  Pregap  Data LBA  End LBA   Total");
@@ -779,93 +1505,55 @@ int main(int argc, const char ** argv)
 			             std::to_string(end_sector) + "," +
 			             std::to_string(total_sector) + "\n";
 
+			trackHashes.push_back({ track, start_sector, total_sector });
+
 			// Check if the track is an audio track
 			if (format == TRACK_FORMAT_AUDIO) {
 				audioSectors += total_sector; // including pregap for whole .bin file.
 
-				// Create a filename based on the track number
+				// Dump the pregap (which can contain hidden data!) and the
+				// track data, in the order in which they are hashed
 				char filename[50];
-				sprintf(filename, "Track_%02d.wav", track);
-
-				fs::path fullPathAudio = psxripDir / filename;
-				std::string fullPathAudioStr = fullPathAudio.string();
-
-				// Open a file to write the audio data
-				FILE *audio_file = fopen(fullPathAudioStr.c_str(), "wb");
-				if (audio_file == NULL) {
-					printf("Failed to open output file\n");
-					return 1;
+				if (pregap_sector > 0) {
+					sprintf(filename, "Pregap_%02d.wav", track);
+					audioJobs.push_back({ start_sector, pregap_sector, psxripDir / filename });
 				}
 
-				// Calculate the size of the audio data in bytes
-				uint32_t data_size = (total_sector - pregap_sector) * CDIO_CD_FRAMESIZE_RAW;
-
-				const uint8_t wav_header[44] = {
-					'R', 'I', 'F', 'F', 0, 0, 0, 0, // Chunk ID and Chunk Size (to be set)
-					'W', 'A', 'V', 'E',             // Format
-					'f', 'm', 't', ' ',             // Subchunk1 ID
-					16, 0, 0, 0,                    // Subchunk1 Size (16 for PCM)
-					1, 0,                           // Audio Format (1 for PCM)
-					2, 0,                           // Num Channels (2 for stereo)
-					0x44, 0xAC, 0x00, 0x00,         // Sample Rate (44100 Hz)
-					0x10, 0xB1, 0x02, 0x00,         // Byte Rate (44100 * 2 * 16/8)
-					4, 0,                           // Block Align (NumChannels * BitsPerSample/8)
-					16, 0,                          // Bits per Sample (16)
-					'd', 'a', 't', 'a', 0, 0, 0, 0  // Subchunk2 ID and Subchunk2 Size (to be set)
-				};
-
-				// Copy the static header and set file-specific sizes
-				uint8_t header[44];
-				memcpy(header, wav_header, 44);
-				*(uint32_t *)(header + 4) = 36 + data_size; // Chunk Size
-				*(uint32_t *)(header + 40) = data_size;     // Subchunk2 Size
-
-				// Write WAV header
-				fwrite(header, 1, 44, audio_file);
-
-				// Read each sector and write audio data to the file (Including pregap! Can contain hidden data!)
-				for (lsn_t sector = data_sector; sector <= end_sector; sector++) {
-					driver_return_code_t r = cdio_read_audio_sector(image, bufferRAW, sector);
-					if (r != DRIVER_OP_SUCCESS) {
-							std::cerr << "Error reading sector " << sector << " of image file: " << cdio_driver_errmsg(r) << std::endl;
-					}
-					fwrite(bufferRAW, 1, CDIO_CD_FRAMESIZE_RAW, audio_file);
-				}
+				sprintf(filename, "Track_%02d.wav", track);
+				audioJobs.push_back({ data_sector, end_sector - data_sector + 1, psxripDir / filename });
+			}
+		}
 
-				fclose(audio_file);
-				
-				// Now take care of the pregap
-				if (pregap_sector > 0) {
-					sprintf(filename, "Pregap_%02d.wav", track);
+		// In a single .bin file, a track extends up to the pregap of the
+		// next one, as in the per-track files of Redump
+		if (!isMultiBin) {
+			for (size_t i = 0; i + 1 < trackHashes.size(); ++i) {
+				trackHashes[i].count = trackHashes[i + 1].first - trackHashes[i].first;
+			}
+		}
+
+		// The tracks are hashed while they are dumped
+		unique_ptr<TrackHasher> hasher;
+		if (hashTracks) {
+			hasher = make_unique<TrackHasher>(image, trackHashes);
+			trackHasher = hasher.get();
 
-					fullPathAudio = psxripDir / filename;
-					fullPathAudioStr = fullPathAudio.string();
-
-					audio_file = fopen(fullPathAudioStr.c_str(), "wb");
-					if (audio_file == NULL) {
-						printf("Failed to open output file\n");
-						return 1;
-					}
-					data_size = (total_sector - pregap_sector) * CDIO_CD_FRAMESIZE_RAW;
-					memcpy(header, wav_header, 44);
-					*(uint32_t *)(header + 4) = 36 + data_size;
-					*(uint32_t *)(header + 40) = data_size;
-
-					fwrite(header, 1, 44, audio_file);
-
-					for (lsn_t sector = start_sector; sector < data_sector; sector++) {
-						driver_return_code_t r = cdio_read_audio_sector(image, bufferRAW, sector);
-						if (r != DRIVER_OP_SUCCESS) {
-								std::cerr << "Error reading sector " << sector << " of image file: " << cdio_driver_errmsg(r) << std::endl;
-						}
-						fwrite(bufferRAW, 1, CDIO_CD_FRAMESIZE_RAW, audio_file);
-					}
-
-					fclose(audio_file);
+			for (const AudioJob & job : audioJobs) {
+				trackHasher->expect(job.first, job.count);
+			}
+			for (const TrackHash & t : trackHashes) {
+				if (cdio_get_track_format(image, t.track) == TRACK_FORMAT_AUDIO) {
+					trackHasher->expectNoMore(t.track);
 				}
 			}
 		}
 
+		// The audio tracks are independent of each other and are dumped by
+		// 'numJobs' threads at once
+		parallelFor(audioJobs.size(), numJobs, [&](size_t i) {
+			dumpAudioTrack(image, audioJobs[i].first, audioJobs[i].count, audioJobs[i].fileName);
+		});
+
 		// Base64 encode the cvsTracks for the catalog file.
 		trackListingEncoded = base64_encode(csvTracks);
 
@@ -948,10 +1636,16 @@ int main(int argc, const char ** argv)
 			throw runtime_error("No ISO 9660 filesystem on data track");
 		}
 
+		if (checkEDC) {
+			cdio_info("Using %s EDC kernel", edcKernelName());
+			verifyEDC(image, last_sector_track1_postgap);
+		}
+
 		if (printLBNTable) {
 
 			// Print the LBN table
-			dumpLBNTable(image);
+			ISOTree tree(image);
+			dumpLBNTable(tree);
 
 		} else {
 
@@ -959,6 +1653,18 @@ int main(int argc, const char ** argv)
 			dumpImage(image, outputPath, writeLBNs, trackListingEncoded, track1PostgapType, last_sector_track1_postgap + 1, audioSectors);
 		}
 
+		// Complete the track hashes and match them against the .dat file
+		if (hashTracks) {
+			trackHasher->finish();
+			trackHasher = nullptr;
+
+			reportTrackHashes(trackHashes, roms, !datPath.empty());
+
+			fs::path catalogName = outputPath;
+			catalogName.replace_extension(".cat");
+			appendTrackHashes(catalogName, trackHashes);
+		}
+
 		// Close the input image
 		cdio_destroy(image);
 		cdio_info("Done.");